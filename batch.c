@@ -0,0 +1,625 @@
+/*
+Batch module
+- Batch functions: run commands from a script or stdin against the
+  clinic data without the interactive menus. Every command prints
+  its result rows (in the data file formats) and then exactly one
+  "ok" or "error|<message>" line.
+- Command functions: one per command, sharing the record functions
+  the menus use so both apply the same rules.
+*/
+
+#define _CRT_SECURE_NO_WARNINGS
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "batch.h"
+#include "clinic.h"
+#include "loader.h"
+#include "stats.h"
+#include "store.h"
+
+//////////////////////////////////////
+// Structures
+//////////////////////////////////////
+
+// Data type: Batch Group (results of the commands run since the last journal sync)
+struct BatchGroup
+{
+    FILE* out;
+#ifndef _WIN32
+    char* text;
+    size_t length;
+#endif
+};
+
+// Data type: Batch Command (name, the function that runs it and whether it changes the data)
+struct BatchCommand
+{
+    const char* name;
+    const char* (*run)(struct ClinicData* data, const char* args, const char* end, FILE* out);
+    int isChange;
+};
+
+
+//////////////////////////////////////
+// OUTPUT FUNCTIONS
+//////////////////////////////////////
+
+// Print a patient as a patient data file line
+static void printPatientRow(FILE* out, const struct Patient* patient)
+{
+    struct Phone phone = { 0 };
+
+    unpackPhone(patient, &phone);
+    fprintf(out, "%d|%s|%s|%s\n", patient->patientNumber, patient->name,
+            phone.description, phone.number);
+}
+
+// Print an appointment as an appointment data file line
+static void printAppointmentRow(FILE* out, const struct Appointment* appoint)
+{
+    struct Date date = { 0 };
+    struct Time time = { 0 };
+
+    unpackAppointment(appoint, &date, &time);
+    fprintf(out, "%d,%d,%d,%d,%d,%d,%d,%d\n", appoint->patientNumber, date.year,
+            date.month, date.day, time.hour, time.min, appoint->room, visitMinutes(appoint));
+}
+
+// Print the patients with a name matching the argument (up to NAME_SEARCH_LIMIT), then ok|count
+static const char* printNameMatches(const struct ClinicData* data, const char* args, const char* end,
+                                    int isFuzzy, FILE* out)
+{
+    char query[NAME_LEN + 1] = { 0 };
+    int slots[NAME_SEARCH_LIMIT];
+    int count = 0, i = 0;
+
+    if (end - args < 1 || end - args > NAME_LEN)
+        return "name must be 1 to 15 characters";
+    memcpy(query, args, (size_t)(end - args));
+
+    count = findPatientsByName(data, query, isFuzzy, slots, NAME_SEARCH_LIMIT);
+    for (i = 0; i < count; i++)
+        printPatientRow(out, &data->patients[slots[i]]);
+    fprintf(out, "ok|%d\n", count);
+
+    return NULL;
+}
+
+
+//////////////////////////////////////
+// ARGUMENT FUNCTIONS
+//////////////////////////////////////
+
+// Parse a patient number that must be the whole argument (returns 1 on success)
+static int scanPatientNumber(const char* args, const char* end, int* patientNumber)
+{
+    return scanInt(&args, end, patientNumber) && *patientNumber > 0 && args == end;
+}
+
+// Parse "year,month,day" (returns 1 on success)
+static int scanDate(const char** cursor, const char* end, struct Date* date)
+{
+    return scanInt(cursor, end, &date->year) && expectChar(cursor, end, ',') &&
+           scanInt(cursor, end, &date->month) && expectChar(cursor, end, ',') &&
+           scanInt(cursor, end, &date->day) &&
+           dayKeyFromDate(date->year, date->month, date->day) != 0;
+}
+
+// Parse "hour,min" (returns 1 on success)
+static int scanTime(const char** cursor, const char* end, struct Time* time)
+{
+    return scanInt(cursor, end, &time->hour) && expectChar(cursor, end, ',') &&
+           scanInt(cursor, end, &time->min) &&
+           time->hour >= 0 && time->hour <= 23 && time->min >= 0 && time->min <= 59;
+}
+
+
+//////////////////////////////////////
+// COMMAND FUNCTIONS
+//////////////////////////////////////
+
+// add-patient|name|description|phone -> ok|number
+static const char* runAddPatient(struct ClinicData* data, const char* args, const char* end, FILE* out)
+{
+    struct Patient patient = { 0 };
+    const char* error = parsePatientFields(args, end, &patient);
+
+    if (error != NULL)
+        return error;
+
+    patient.patientNumber = nextPatientNumber(data);
+    if (addPatientRecord(data, &patient) == -1)
+        return "patient record could not be added";
+
+    fprintf(out, "ok|%d\n", patient.patientNumber);
+
+    return NULL;
+}
+
+// edit-patient|number|name|description|phone -> ok
+static const char* runEditPatient(struct ClinicData* data, const char* args, const char* end, FILE* out)
+{
+    struct Patient patient = { 0 };
+    const char* error = parsePatientLine(args, end, &patient);
+    int slot = -1;
+
+    if (error != NULL)
+        return error;
+
+    slot = findPatientIndexByPatientNum(patient.patientNumber, data);
+    if (slot == -1)
+        return "patient record not found";
+    if (!updatePatientRecord(data, slot, &patient))
+        return "patient record could not be updated";
+
+    fprintf(out, "ok\n");
+
+    return NULL;
+}
+
+// remove-patient|number -> ok
+static const char* runRemovePatient(struct ClinicData* data, const char* args, const char* end, FILE* out)
+{
+    int number = 0, slot = -1;
+
+    if (!scanPatientNumber(args, end, &number))
+        return "invalid patient number";
+
+    slot = findPatientIndexByPatientNum(number, data);
+    if (slot == -1)
+        return "patient record not found";
+    if (removePatientRecord(data, slot) == -1)
+        return "patient record could not be removed";
+
+    fprintf(out, "ok\n");
+
+    return NULL;
+}
+
+// find-patient|number -> patient row, ok|1
+static const char* runFindPatient(struct ClinicData* data, const char* args, const char* end, FILE* out)
+{
+    int number = 0, slot = -1;
+
+    if (!scanPatientNumber(args, end, &number))
+        return "invalid patient number";
+
+    slot = findPatientRecord(data, number);
+    if (slot == -1)
+        return "patient record not found";
+
+    printPatientRow(out, &data->patients[slot]);
+    fprintf(out, "ok|1\n");
+
+    return NULL;
+}
+
+// find-phone|phone -> patient rows, ok|count
+static const char* runFindPhone(struct ClinicData* data, const char* args, const char* end, FILE* out)
+{
+    char phoneNumber[PHONE_LEN + 1] = { 0 };
+    long long key = 0;
+    int slot = -1, count = 0;
+    STATS_START(started);
+
+    if (end - args == PHONE_LEN)
+    {
+        memcpy(phoneNumber, args, PHONE_LEN);
+        key = phoneKeyFromString(phoneNumber);
+    }
+    if (key == 0)
+        return "phone number must be 10 digits";
+
+    for (slot = multiIndexFirst(&data->phoneIndex, key); slot != -1;
+         slot = multiIndexNext(&data->phoneIndex, slot))
+    {
+        printPatientRow(out, &data->patients[slot]);
+        count++;
+    }
+    fprintf(out, "ok|%d\n", count);
+    STATS_STOP(STATS_FIND_PHONE, started, count);
+
+    return NULL;
+}
+
+// find-name|start of a name word -> patient rows, ok|count
+static const char* runFindName(struct ClinicData* data, const char* args, const char* end, FILE* out)
+{
+    return printNameMatches(data, args, end, 0, out);
+}
+
+// fuzzy-name|name words, allowing typos -> patient rows, ok|count
+static const char* runFuzzyName(struct ClinicData* data, const char* args, const char* end, FILE* out)
+{
+    return printNameMatches(data, args, end, 1, out);
+}
+
+// book|patient,year,month,day,hour,min[,room,minutes] -> ok
+static const char* runBook(struct ClinicData* data, const char* args, const char* end, FILE* out)
+{
+    struct Appointment appoint = { 0 };
+    struct Time time = { 0 };
+    const char* error = parseAppointmentLine(args, end, &appoint);
+
+    if (error != NULL)
+        return error;
+    unpackAppointment(&appoint, NULL, &time);
+
+    if (findPatientIndexByPatientNum(appoint.patientNumber, data) == -1)
+        return "patient record not found";
+    if (!isAppointmentTime(&time))
+        return "time is outside the appointment hours and intervals";
+    if (appointmentTimeslot(&appoint) == -1)
+        return "visit runs past the last timeslot";
+    if (!isTimeslotAvailable(data, &appoint))
+        return "appointment timeslot is not available";
+    if (addAppointmentRecord(data, &appoint) == -1)
+        return "appointment record could not be added";
+
+    fprintf(out, "ok\n");
+
+    return NULL;
+}
+
+// cancel|patient,year,month,day -> ok
+static const char* runCancel(struct ClinicData* data, const char* args, const char* end, FILE* out)
+{
+    struct Date date = { 0 };
+    const char* cur = args;
+    int number = 0, slot = -1;
+
+    if (!scanInt(&cur, end, &number) || number == 0 || !expectChar(&cur, end, ',') ||
+        !scanDate(&cur, end, &date) || cur != end)
+        return "expected patient,year,month,day";
+
+    if (findPatientIndexByPatientNum(number, data) == -1)
+        return "patient record not found";
+
+    slot = findAppointmentSlot(data, number, &date);
+    if (slot == -1)
+        return "appointment record not found";
+    if (!removeAppointmentRecord(data, slot))
+        return "appointment record could not be removed";
+
+    fprintf(out, "ok\n");
+
+    return NULL;
+}
+
+// appointments|patient -> the patient's appointment rows in date/time order (up to PATIENT_APPOINTMENT_LIMIT), ok|count
+static const char* runAppointments(struct ClinicData* data, const char* args, const char* end, FILE* out)
+{
+    int slots[PATIENT_APPOINTMENT_LIMIT];
+    int number = 0, count = 0, i = 0;
+
+    if (!scanPatientNumber(args, end, &number))
+        return "invalid patient number";
+    if (findPatientIndexByPatientNum(number, data) == -1)
+        return "patient record not found";
+
+    count = findPatientAppointments(data, number, slots, PATIENT_APPOINTMENT_LIMIT);
+    if (count > PATIENT_APPOINTMENT_LIMIT)
+        count = PATIENT_APPOINTMENT_LIMIT;
+    for (i = 0; i < count; i++)
+        printAppointmentRow(out, &data->appointments[slots[i]]);
+    fprintf(out, "ok|%d\n", count);
+
+    return NULL;
+}
+
+// schedule|year,month,day -> appointment rows, ok|count
+static const char* runSchedule(struct ClinicData* data, const char* args, const char* end, FILE* out)
+{
+    struct Date date = { 0 };
+    const char* cur = args;
+    int position = 0, first = 0, slot = -1, count = 0, day = 0;
+    STATS_START(started);
+
+    if (!scanDate(&cur, end, &date) || cur != end)
+        return "expected year,month,day";
+    day = dayKeyFromDate(date.year, date.month, date.day);
+    first = storeFirstAppointmentOnDay(data, day);
+
+    for (position = first; isAppointmentOnDay(data, position, day); position++)
+    {
+        slot = storeAppointmentAt(data, position);
+        if (slot != -1)
+        {
+            printAppointmentRow(out, &data->appointments[slot]);
+            count++;
+        }
+    }
+    fprintf(out, "ok|%d\n", count);
+    STATS_STOP(STATS_VIEW_SCHEDULE, started, position - first);
+
+    return NULL;
+}
+
+// range|year,month,day,year,month,day -> appointment rows from the first date to the second, ok|count
+static const char* runRange(struct ClinicData* data, const char* args, const char* end, FILE* out)
+{
+    struct Date from = { 0 }, to = { 0 };
+    const char* cur = args;
+    int position = 0, first = 0, last = 0, slot = -1, count = 0;
+    STATS_START(started);
+
+    if (!scanDate(&cur, end, &from) || !expectChar(&cur, end, ',') || !scanDate(&cur, end, &to) || cur != end)
+        return "expected year,month,day,year,month,day";
+    if (dayKeyFromDate(to.year, to.month, to.day) < dayKeyFromDate(from.year, from.month, from.day))
+        return "end date is before the start date";
+    first = findAppointmentRange(data, &from, &to, &last);
+
+    for (position = first; position < last; position++)
+    {
+        slot = storeAppointmentAt(data, position);
+        if (slot != -1)
+        {
+            printAppointmentRow(out, &data->appointments[slot]);
+            count++;
+        }
+    }
+    fprintf(out, "ok|%d\n", count);
+    STATS_STOP(STATS_VIEW_RANGE, started, last - first);
+
+    return NULL;
+}
+
+// free|year,month,day,count[,room,minutes[,hour,min,hour,min]] -> "year,month,day,hour,min,room" rows, ok|count
+static const char* runFree(struct ClinicData* data, const char* args, const char* end, FILE* out)
+{
+    struct Appointment found[BATCH_FREE_LIMIT];
+    struct Date date = { 0 };
+    struct Time earliest = { 0 }, latest = { 0 }, time = { 0 };
+    const char* cur = args;
+    int count = 0, room = 0, minutes = APPOINTMENT_INTERVAL, hasWindow = 0, i = 0;
+
+    if (!scanDate(&cur, end, &date) || !expectChar(&cur, end, ',') ||
+        !scanInt(&cur, end, &count) || count < 1 || count > BATCH_FREE_LIMIT)
+        return "expected year,month,day,count (count 1-100)";
+
+    // Room 0 searches every room; a visit is at most a day of timeslots, as packVisit allows
+    if (cur != end && (!expectChar(&cur, end, ',') || !scanInt(&cur, end, &room) ||
+                       room < 0 || room > CLINIC_ROOMS || !expectChar(&cur, end, ',') ||
+                       !scanInt(&cur, end, &minutes) || minutes < APPOINTMENT_INTERVAL ||
+                       minutes % APPOINTMENT_INTERVAL != 0 ||
+                       minutes > TIMESLOTS_PER_DAY * APPOINTMENT_INTERVAL))
+        return "expected a room (0 for any) and minutes";
+
+    hasWindow = cur != end;
+    if (hasWindow && (!expectChar(&cur, end, ',') || !scanTime(&cur, end, &earliest) ||
+                      !expectChar(&cur, end, ',') || !scanTime(&cur, end, &latest) || cur != end))
+        return "expected a time window of hour,min,hour,min";
+
+    count = findFreeTimeslots(data, &date, hasWindow ? &earliest : NULL, hasWindow ? &latest : NULL,
+                              room, minutes / APPOINTMENT_INTERVAL, found, count);
+    for (i = 0; i < count; i++)
+    {
+        unpackAppointment(&found[i], &date, &time);
+        fprintf(out, "%d,%d,%d,%d,%d,%d\n", date.year, date.month, date.day, time.hour, time.min,
+                found[i].room);
+    }
+    fprintf(out, "ok|%d\n", count);
+
+    return NULL;
+}
+
+// rooms|year,month,day,hour,min[,minutes] -> room number rows, ok|count
+static const char* runRooms(struct ClinicData* data, const char* args, const char* end, FILE* out)
+{
+    struct Appointment visit = { 0 };
+    struct Date date = { 0 };
+    struct Time time = { 0 };
+    const char* cur = args;
+    int rooms[CLINIC_ROOMS];
+    int minutes = APPOINTMENT_INTERVAL, count = 0, i = 0;
+
+    if (!scanDate(&cur, end, &date) || !expectChar(&cur, end, ',') || !scanTime(&cur, end, &time) ||
+        (cur != end && (!expectChar(&cur, end, ',') || !scanInt(&cur, end, &minutes))) || cur != end)
+        return "expected year,month,day,hour,min[,minutes]";
+    if (!packAppointment(&visit, 0, &date, &time) || !packVisit(&visit, 1, minutes))
+        return "invalid visit date or length";
+
+    // The same checks as book, so a visit that could never be booked is an error rather than no rooms
+    if (!isAppointmentTime(&time))
+        return "time is outside the appointment hours and intervals";
+    if (appointmentTimeslot(&visit) == -1)
+        return "visit runs past the last timeslot";
+
+    count = findFreeRooms(data, &visit, rooms);
+    for (i = 0; i < count; i++)
+        fprintf(out, "%d\n", rooms[i]);
+    fprintf(out, "ok|%d\n", count);
+
+    return NULL;
+}
+
+// stats| -> "operation,calls,scanned,mean_ns,p50_ns,p90_ns,p99_ns,max_ns" rows, ok|count
+static const char* runStats(struct ClinicData* data, const char* args, const char* end, FILE* out)
+{
+    int count = 0;
+
+    (void)data;
+    if (args != end)
+        return "stats takes no arguments";
+
+    count = statsWrite(out);
+    if (count == -1)
+        return "statistics are compiled out";
+    fprintf(out, "ok|%d\n", count);
+
+    return NULL;
+}
+
+
+//////////////////////////////////////
+// BATCH FUNCTIONS
+//////////////////////////////////////
+
+// Find a command by name (returns NULL if there is none)
+static const struct BatchCommand* findCommand(const char* name, const char* nameEnd)
+{
+    static const struct BatchCommand commands[] = {
+        { "add-patient", runAddPatient, 1 },
+        { "edit-patient", runEditPatient, 1 },
+        { "remove-patient", runRemovePatient, 1 },
+        { "find-patient", runFindPatient, 0 },
+        { "find-phone", runFindPhone, 0 },
+        { "find-name", runFindName, 0 },
+        { "fuzzy-name", runFuzzyName, 0 },
+        { "book", runBook, 1 },
+        { "cancel", runCancel, 1 },
+        { "appointments", runAppointments, 0 },
+        { "schedule", runSchedule, 0 },
+        { "range", runRange, 0 },
+        { "free", runFree, 0 },
+        { "rooms", runRooms, 0 },
+        { "stats", runStats, 0 }
+    };
+    size_t nameLength = (size_t)(nameEnd - name);
+    int i = 0;
+
+    for (i = 0; i < (int)(sizeof(commands) / sizeof(commands[0])); i++)
+    {
+        if (strlen(commands[i].name) == nameLength &&
+            memcmp(commands[i].name, name, nameLength) == 0)
+            return &commands[i];
+    }
+
+    return NULL;
+}
+
+// Check if a command line changes the clinic data (unknown commands do not)
+int isBatchChange(const char* line, const char* end)
+{
+    const char* args = memchr(line, '|', (size_t)(end - line));
+    const struct BatchCommand* command = args != NULL ? findCommand(line, args) : NULL;
+
+    return command != NULL && command->isChange;
+}
+
+// Run one command line, writing its result rows and result line to 'out' (returns 1 on success, 0 on failure)
+int runBatchLine(struct ClinicData* data, const char* line, const char* end, FILE* out)
+{
+    const char* args = memchr(line, '|', (size_t)(end - line));
+    const struct BatchCommand* command = args != NULL ? findCommand(line, args) : NULL;
+    const char* error = NULL;
+
+    if (args == NULL)
+        error = "expected command|arguments";
+    else if (command == NULL)
+        error = "unknown command";
+    else
+        error = command->run(data, args + 1, end, out);
+
+    if (error != NULL)
+        fprintf(out, "error|%s\n", error);
+
+    return error == NULL;
+}
+
+// Start holding back the results of a group of commands (returns 1 on success, 0 if out of memory)
+static int openBatchGroup(struct BatchGroup* group)
+{
+#ifndef _WIN32
+    group->text = NULL;
+    group->length = 0;
+    group->out = open_memstream(&group->text, &group->length);
+#else
+    group->out = tmpfile();
+#endif
+
+    return group->out != NULL;
+}
+
+// Close a group, printing its results only if the journal sync for its changes succeeded
+static void closeBatchGroup(struct BatchGroup* group, int isSynced)
+{
+#ifndef _WIN32
+    fclose(group->out);
+    if (isSynced)
+        fwrite(group->text, 1, group->length, stdout);
+    free(group->text);
+#else
+    char buffer[BUFSIZ];
+    size_t length = 0;
+
+    rewind(group->out);
+    while (isSynced && (length = fread(buffer, 1, sizeof(buffer), group->out)) > 0)
+        fwrite(buffer, 1, length, stdout);
+    fclose(group->out);
+#endif
+    fflush(stdout);
+}
+
+// Run the batch commands read from a stream, one result line each (returns # of failed commands,
+// -1 if it stopped early because changes could not be journaled or it ran out of memory)
+int runBatch(FILE* input, struct ClinicData* data)
+{
+    struct BatchGroup group = { 0 };
+    char line[BATCH_LINE_LEN] = { 0 };
+    size_t length = 0;
+    int failed = 0, pending = 0, isTooLong = 0, isSynced = 1, isOpen = 0, c = 0;
+
+    // Results are held back until the journal sync for the changes they report
+    isOpen = openBatchGroup(&group);
+
+    // Changes in a run of commands share one journal sync
+    journalDeferSync(data, 1);
+
+    while (isSynced && isOpen && fgets(line, sizeof(line), input) != NULL)
+    {
+        // A line that fills the buffer is too long unless its line break comes next
+        length = strlen(line);
+        isTooLong = 0;
+        if (length == sizeof(line) - 1 && line[length - 1] != '\n')
+        {
+            while ((c = fgetc(input)) != EOF && c != '\n')
+                isTooLong = 1;
+        }
+
+        // Accept scripts saved with CRLF line endings
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+            length--;
+
+        if (!isTooLong && (length == 0 || line[0] == '#'))
+            continue;
+
+        if (isTooLong)
+        {
+            fprintf(group.out, "error|command line is too long\n");
+            failed++;
+        }
+        else if (!runBatchLine(data, line, line + length, group.out))
+            failed++;
+
+        if (++pending == BATCH_SYNC_INTERVAL)
+        {
+            isSynced = journalSync(data);
+            closeBatchGroup(&group, isSynced);
+            if (isSynced)
+            {
+                pending = 0;
+                isOpen = openBatchGroup(&group);
+            }
+        }
+    }
+
+    if (isSynced && isOpen)
+    {
+        isSynced = journalSync(data);
+        closeBatchGroup(&group, isSynced);
+    }
+    journalDeferSync(data, 0);
+
+    // Nothing after the last good sync is confirmed, so the run stops there
+    if (!isSynced)
+        fprintf(stderr, "ERROR: The results of the last %d commands were dropped\n", pending);
+    else if (!isOpen)
+        fprintf(stderr, "ERROR: Out of memory\n");
+
+    return isSynced && isOpen ? failed : -1;
+}
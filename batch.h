@@ -0,0 +1,31 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdio.h>
+
+#include "clinic.h"
+
+// Longest batch command line (including the line break)
+#define BATCH_LINE_LEN 256
+
+// Most free timeslots one "free" command lists
+#define BATCH_FREE_LIMIT 100
+
+// Commands run between journal syncs (their results are printed after each sync)
+#define BATCH_SYNC_INTERVAL 256
+
+//////////////////////////////////////
+// BATCH FUNCTIONS
+//////////////////////////////////////
+
+// Check if a command line changes the clinic data (unknown commands do not)
+int isBatchChange(const char* line, const char* end);
+
+// Run one command line, writing its result rows and result line to 'out' (returns 1 on success, 0 on failure)
+int runBatchLine(struct ClinicData* data, const char* line, const char* end, FILE* out);
+
+// Run the batch commands read from a stream, one result line each (returns # of failed commands,
+// -1 if it stopped early because changes could not be journaled or it ran out of memory)
+int runBatch(FILE* input, struct ClinicData* data);
+
+#endif // !BATCH_H
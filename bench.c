@@ -0,0 +1,459 @@
+/*
+Benchmark module
+- Generator functions: write synthetic patient and appointment data
+  files in the data file formats, at any scale and repeatable from a
+  seed. Pets of one owner share a surname and phone, and visits fill
+  each room's days from BENCH_FIRST_YEAR on without overlapping; the
+  appointment lines are written in random order, like the real file.
+- Benchmark functions: time the clinic.c hot paths on the data files
+  and print one CSV row per operation: records, operations timed, ns
+  per operation and the p50/p90/p99/max latency of one operation.
+  Views are timed writing to /dev/null.
+*/
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#include "bench.h"
+#include "clinic.h"
+#include "store.h"
+
+// Names generated patients are made from
+static const char* const petNames[] = {
+    "Shaggy", "Pugsley", "Beans", "Banjo", "Lettuce", "Bullet", "Nugget", "Bessie",
+    "Potato", "Alfie", "Pickles", "Archie", "Wyatt", "Bug", "Noodles", "Chicken",
+    "Spikey", "Carrots", "Insect", "Dilly", "Rosy", "Rover", "Mugsy", "Biscuit",
+    "Pepper", "Mochi", "Ziggy", "Olive", "Tofu", "Waffles", "Luna", "Max"
+};
+static const char* const surnames[] = {
+    "Yanson", "Maulin", "Codi", "Peas", "Lemme", "Smee", "Lidgely", "Yards",
+    "Burnhard", "Green", "Ashness", "Tevlin", "Ickov", "Mollen", "Brown", "Westrey",
+    "Davidov", "Malone", "Okafor", "Nguyen", "Patel", "Kowalski", "Silva", "Moreau"
+};
+
+//////////////////////////////////////
+// BENCHMARK HELPER FUNCTIONS
+//////////////////////////////////////
+
+// Next number of a seeded xorshift64* sequence (the same on every platform, unlike rand)
+static unsigned int nextRandom(unsigned long long* state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+
+    return (unsigned int)((*state * 2685821657736338717ULL) >> 32);
+}
+
+// Random number from 0 to limit - 1
+static int randomBelow(unsigned long long* state, int limit)
+{
+    return (int)(nextRandom(state) % (unsigned int)limit);
+}
+
+// Write the patient file, keeping each patient's number for the appointments (returns 1 on success, 0 on failure)
+static int generatePatients(const char* patientFile, int* numbers, int patients, unsigned long long* state)
+{
+    static const int phoneTypes[] = { PHONE_CELL, PHONE_CELL, PHONE_CELL, PHONE_CELL, PHONE_CELL,
+                                      PHONE_HOME, PHONE_HOME, PHONE_HOME, PHONE_WORK, PHONE_TBD };
+    char name[NAME_LEN + 1];
+    const char* surname = NULL;
+    long long phone = 0;
+    int i = 0, number = BENCH_FIRST_PATIENT - 1, phoneType = PHONE_TBD;
+    FILE* fp = fopen(patientFile, "w");
+
+    if (fp == NULL)
+        return 0;
+    setvbuf(fp, NULL, _IOFBF, 1 << 20);
+
+    for (i = 0; i < patients; i++)
+    {
+        // Gaps in the numbers stand in for removed patients
+        number += 1 + randomBelow(state, 8);
+        numbers[i] = number;
+
+        // Three pets in ten belong to the previous pet's owner
+        if (i == 0 || randomBelow(state, 10) >= 3)
+        {
+            surname = surnames[randomBelow(state, (int)(sizeof(surnames) / sizeof(surnames[0])))];
+            phoneType = phoneTypes[randomBelow(state, (int)(sizeof(phoneTypes) / sizeof(phoneTypes[0])))];
+            phone = nextRandom(state);
+            phone = 2000000000LL + (long long)(((unsigned long long)phone << 32 | nextRandom(state)) % 8000000000ULL);
+        }
+        snprintf(name, sizeof(name), "%s %s",
+                 petNames[randomBelow(state, (int)(sizeof(petNames) / sizeof(petNames[0])))], surname);
+
+        if (phoneType == PHONE_TBD)
+            fprintf(fp, "%d|%s|%s|\n", number, name, phoneTypeName(phoneType));
+        else
+            fprintf(fp, "%d|%s|%s|%lld\n", number, name, phoneTypeName(phoneType), phone);
+    }
+
+    return fclose(fp) == 0;
+}
+
+// Write the appointment file in random order (returns 1 on success, 0 on failure)
+static int generateAppointments(const char* appointmentFile, const int* numbers, int patients,
+                                int appointments, unsigned long long* state)
+{
+    struct Appointment* visits = malloc((appointments > 0 ? (size_t)appointments : 1) * sizeof(*visits));
+    struct Appointment swap = { 0 };
+    struct Date date = { 1, 1, BENCH_FIRST_YEAR };
+    struct Time time = { 0 };
+    int count = 0, room = 0, slot = 0, length = 0, i = 0, isWritten = 0;
+    FILE* fp = NULL;
+
+    if (visits == NULL)
+        return 0;
+
+    while (count < appointments)
+    {
+        // A room stays idle for about one timeslot in four; most visits take one timeslot
+        for (room = 1; room <= CLINIC_ROOMS; room++)
+        {
+            for (slot = 0; slot < TIMESLOTS_PER_DAY && count < appointments; slot += length)
+            {
+                length = randomBelow(state, 10);
+                length = length < 7 ? 1 : length < 9 ? 2 : 3;
+                if (slot + length > TIMESLOTS_PER_DAY)
+                    length = TIMESLOTS_PER_DAY - slot;
+                if (randomBelow(state, 4) == 0)
+                    length = 1;
+                else
+                {
+                    time.hour = MIN_HOUR + slot * APPOINTMENT_INTERVAL / 60;
+                    time.min = slot * APPOINTMENT_INTERVAL % 60;
+                    packAppointment(&visits[count], numbers[randomBelow(state, patients)], &date, &time);
+                    packVisit(&visits[count], room, length * APPOINTMENT_INTERVAL);
+                    count++;
+                }
+            }
+        }
+
+        if (++date.day > daysInMonth(date.year, date.month))
+        {
+            date.day = 1;
+            if (++date.month > 12)
+            {
+                date.month = 1;
+                date.year++;
+            }
+        }
+    }
+
+    // Fisher-Yates shuffle
+    for (i = count - 1; i > 0; i--)
+    {
+        slot = randomBelow(state, i + 1);
+        swap = visits[i];
+        visits[i] = visits[slot];
+        visits[slot] = swap;
+    }
+
+    fp = fopen(appointmentFile, "w");
+    if (fp != NULL)
+    {
+        setvbuf(fp, NULL, _IOFBF, 1 << 20);
+        for (i = 0; i < count; i++)
+        {
+            unpackAppointment(&visits[i], &date, &time);
+            fprintf(fp, "%d,%d,%d,%d,%d,%d,%d,%d\n", visits[i].patientNumber, date.year, date.month,
+                    date.day, time.hour, time.min, visits[i].room, visitMinutes(&visits[i]));
+        }
+        isWritten = fclose(fp) == 0;
+    }
+    free(visits);
+
+    return isWritten;
+}
+
+
+// Timing needs the POSIX clock and descriptors
+#ifndef _WIN32
+
+// Current monotonic time in nanoseconds
+static long long clockNanoseconds(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+// Compare two timings (for qsort)
+static int compareTimings(const void* a, const void* b)
+{
+    long long left = *(const long long*)a, right = *(const long long*)b;
+
+    return (left > right) - (left < right);
+}
+
+// Send stdout to /dev/null while views are timed (returns the descriptor to restore, -1 on failure)
+static int silenceOutput(void)
+{
+    int saved = -1, discard = open("/dev/null", O_WRONLY);
+
+    fflush(stdout);
+    if (discard != -1)
+    {
+        saved = dup(STDOUT_FILENO);
+        if (saved != -1 && dup2(discard, STDOUT_FILENO) == -1)
+        {
+            close(saved);
+            saved = -1;
+        }
+        close(discard);
+    }
+
+    return saved;
+}
+
+// Send stdout back where it went before silenceOutput
+static void restoreOutput(int saved)
+{
+    fflush(stdout);
+    if (saved != -1)
+    {
+        dup2(saved, STDOUT_FILENO);
+        close(saved);
+    }
+}
+
+// Print an operation's CSV row from its samples, each the time of 'batch' operations (sorts the samples)
+static void reportTimings(const char* operation, int records, long long* samples, int count, int batch)
+{
+    long long total = 0;
+    int i = 0;
+
+    for (i = 0; i < count; i++)
+        total += samples[i];
+    qsort(samples, (size_t)count, sizeof(*samples), compareTimings);
+
+    printf("%s,%d,%d,%.1f,%.1f,%.1f,%.1f,%.1f\n", operation, records, count * batch,
+           (double)total / ((double)count * batch),
+           (double)samples[count / 2] / batch, (double)samples[(count - 1) * 90 / 100] / batch,
+           (double)samples[(count - 1) * 99 / 100] / batch, (double)samples[count - 1] / batch);
+    fflush(stdout);
+}
+
+#endif
+
+//////////////////////////////////////
+// GENERATOR FUNCTIONS
+//////////////////////////////////////
+
+// Write synthetic patient and appointment data files in the data file formats (returns 1 on success, 0 on failure)
+int generateClinicData(const char* patientFile, const char* appointmentFile,
+                       int patients, int appointments, unsigned int seed)
+{
+    unsigned long long state = 0x9E3779B97F4A7C15ULL ^ seed;
+    int* numbers = NULL;
+    int isWritten = 0;
+
+    if (patients < 1 || appointments < 0)
+    {
+        fprintf(stderr, "ERROR: A data set needs at least one patient\n");
+        return 0;
+    }
+
+    numbers = malloc((size_t)patients * sizeof(int));
+    if (numbers == NULL)
+        fprintf(stderr, "ERROR: Not enough memory for %d patients\n", patients);
+    else
+    {
+        isWritten = generatePatients(patientFile, numbers, patients, &state) &&
+                    generateAppointments(appointmentFile, numbers, patients, appointments, &state);
+        if (!isWritten)
+            fprintf(stderr, "ERROR: Could not write %s and %s\n", patientFile, appointmentFile);
+    }
+    free(numbers);
+
+    return isWritten;
+}
+
+
+//////////////////////////////////////
+// BENCHMARK FUNCTIONS
+//////////////////////////////////////
+
+#ifndef _WIN32
+
+// Time the clinic operations on the data files, printing a CSV row per operation (returns 1 on success, 0 on failure)
+int runBenchmark(const char* patientFile, const char* appointmentFile, int operations)
+{
+    struct ClinicData data;
+    struct Appointment* sorted = NULL;
+    struct Date date = { 0 }, to = { 0 };
+    long long* samples = NULL;
+    long long* importTimes = NULL;
+    long long started = 0;
+    unsigned long long state = 0x9E3779B97F4A7C15ULL;
+    int run = 0, i = 0, j = 0, slot = 0, found = 0, saved = -1, batches = 0, tries = 0;
+
+    if (operations < BENCH_BATCH)
+        operations = BENCH_BATCH;
+    batches = operations / BENCH_BATCH;
+
+    samples = malloc((size_t)operations * sizeof(*samples));
+    importTimes = malloc(BENCH_RUNS * sizeof(*importTimes));
+    if (samples == NULL || importTimes == NULL)
+    {
+        fprintf(stderr, "ERROR: Not enough memory for %d operations\n", operations);
+        free(samples);
+        free(importTimes);
+        return 0;
+    }
+
+    printf("operation,records,operations,ns_per_op,p50_ns,p90_ns,p99_ns,max_ns\n");
+
+    // Each run imports into an empty store; the last run's store is used for the rest
+    storeInit(&data);
+    for (run = 0; run < BENCH_RUNS; run++)
+    {
+        if (run > 0)
+            storeFree(&data);
+        started = clockNanoseconds();
+        importPatients(patientFile, &data);
+        samples[run] = clockNanoseconds() - started;
+        started = clockNanoseconds();
+        importAppointments(appointmentFile, &data);
+        importTimes[run] = clockNanoseconds() - started;
+    }
+    reportTimings("importPatients", data.patientCount, samples, BENCH_RUNS, 1);
+    reportTimings("importAppointments", data.appointmentCount, importTimes, BENCH_RUNS, 1);
+
+    if (data.patientCount == 0 || data.appointmentCount == 0)
+    {
+        fprintf(stderr, "ERROR: The benchmark needs patients and appointments in %s and %s\n",
+                patientFile, appointmentFile);
+        storeFree(&data);
+        free(samples);
+        free(importTimes);
+        return 0;
+    }
+
+    // Slots hold the appointments in file order, so each run sorts an unsorted copy
+    sorted = malloc((size_t)data.appointmentSlotCount * sizeof(*sorted));
+    for (run = 0; sorted != NULL && run < BENCH_RUNS; run++)
+    {
+        memcpy(sorted, data.appointments, (size_t)data.appointmentSlotCount * sizeof(*sorted));
+        started = clockNanoseconds();
+        sortAppointments(sorted, data.appointmentSlotCount);
+        samples[run] = clockNanoseconds() - started;
+    }
+    if (sorted != NULL)
+        reportTimings("sortAppointments", data.appointmentSlotCount, samples, BENCH_RUNS, 1);
+    free(sorted);
+
+    for (i = 0; i < batches; i++)
+    {
+        slot = randomBelow(&state, data.patientCount);
+        started = clockNanoseconds();
+        for (j = 0; j < BENCH_BATCH; j++)
+            found += findPatientIndexByPatientNum(data.patients[(slot + j) % data.patientCount].patientNumber, &data) >= 0;
+        samples[i] = clockNanoseconds() - started;
+    }
+    reportTimings("findPatientIndexByPatientNum", data.patientCount, samples, batches, BENCH_BATCH);
+    if (found != batches * BENCH_BATCH)
+        fprintf(stderr, "ERROR: %d patient lookups failed\n", batches * BENCH_BATCH - found);
+
+    saved = silenceOutput();
+    for (i = 0; i < operations; i++)
+    {
+        // Patients with no phone (TBD) can't be searched for by one
+        tries = 0;
+        do {
+            slot = randomBelow(&state, data.patientCount);
+        } while (data.patients[slot].phoneKey == 0 && ++tries < 1000);
+
+        started = clockNanoseconds();
+        displayPatientsByPhone(&data, data.patients[slot].phoneKey);
+        samples[i] = clockNanoseconds() - started;
+    }
+    restoreOutput(saved);
+    reportTimings("searchPatientByPhoneNumber", data.patientCount, samples, operations, 1);
+
+    saved = silenceOutput();
+    for (i = 0; i < operations; i++)
+    {
+        do {
+            slot = randomBelow(&state, data.appointmentSlotCount);
+        } while (!isAppointmentLive(&data, slot));
+        unpackAppointment(&data.appointments[slot], &date, NULL);
+
+        started = clockNanoseconds();
+        displayAppointmentSchedule(&data, &date);
+        samples[i] = clockNanoseconds() - started;
+    }
+    restoreOutput(saved);
+    reportTimings("viewAppointmentSchedule", data.appointmentCount, samples, operations, 1);
+
+    saved = silenceOutput();
+    for (i = 0; i < operations; i++)
+    {
+        do {
+            slot = randomBelow(&state, data.appointmentSlotCount);
+        } while (!isAppointmentLive(&data, slot));
+        unpackAppointment(&data.appointments[slot], &date, NULL);
+
+        // The range ends BENCH_RANGE_DAYS - 1 days later, rolling into the next month or year
+        to = date;
+        to.day += BENCH_RANGE_DAYS - 1;
+        if (to.day > daysInMonth(to.year, to.month))
+        {
+            to.day -= daysInMonth(to.year, to.month);
+            if (++to.month > 12)
+            {
+                to.month = 1;
+                to.year++;
+            }
+        }
+
+        started = clockNanoseconds();
+        displayAppointmentRange(&data, &date, &to);
+        samples[i] = clockNanoseconds() - started;
+    }
+    restoreOutput(saved);
+    reportTimings("viewAppointmentRange", data.appointmentCount, samples, operations, 1);
+
+    saved = silenceOutput();
+    for (run = 0; run < BENCH_RUNS; run++)
+    {
+        started = clockNanoseconds();
+        viewAllAppointments(&data);
+        samples[run] = clockNanoseconds() - started;
+    }
+    restoreOutput(saved);
+    reportTimings("viewAllAppointments", data.appointmentCount, samples, BENCH_RUNS, 1);
+
+    storeFree(&data);
+    free(samples);
+    free(importTimes);
+
+    return 1;
+}
+
+#else
+
+// Time the clinic operations on the data files, printing a CSV row per operation (returns 1 on success, 0 on failure)
+int runBenchmark(const char* patientFile, const char* appointmentFile, int operations)
+{
+    (void)patientFile;
+    (void)appointmentFile;
+    (void)operations;
+    fprintf(stderr, "ERROR: The benchmark needs a POSIX system\n");
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+// First patient number a generated data set uses
+#define BENCH_FIRST_PATIENT 1024
+
+// Year generated appointments start in (they fill days from January 1st on)
+#define BENCH_FIRST_YEAR 2024
+
+// Runs of each whole-store operation (imports, sorting, listing every appointment)
+#define BENCH_RUNS 5
+
+// Lookups and views timed per operation when no other count is given
+#define BENCH_OPERATIONS 100000
+
+// Patient number lookups timed together (one alone is too quick for the clock)
+#define BENCH_BATCH 64
+
+// Days covered by a timed date-range view (a weekly report)
+#define BENCH_RANGE_DAYS 7
+
+//////////////////////////////////////
+// GENERATOR FUNCTIONS
+//////////////////////////////////////
+
+// Write synthetic patient and appointment data files in the data file formats (returns 1 on success, 0 on failure)
+int generateClinicData(const char* patientFile, const char* appointmentFile,
+                       int patients, int appointments, unsigned int seed);
+
+
+//////////////////////////////////////
+// BENCHMARK FUNCTIONS
+//////////////////////////////////////
+
+// Time the clinic operations on the data files, printing a CSV row per operation (returns 1 on success, 0 on failure)
+int runBenchmark(const char* patientFile, const char* appointmentFile, int operations);
+
+#endif // !BENCH_H
@@ -0,0 +1,298 @@
+/*
+Client module
+- Client functions: a local test client for server mode. It sends
+  batch command lines over one or more connections at once, waits
+  for each result line before sending the connection's next command
+  and reports throughput and latency percentiles.
+- With one connection the replies are printed exactly as batch mode
+  prints them, so the two can be compared.
+*/
+
+#define _CRT_SECURE_NO_WARNINGS
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#include "batch.h"
+#include "client.h"
+#include "store.h"
+
+#ifndef _WIN32
+
+//////////////////////////////////////
+// Structures
+//////////////////////////////////////
+
+// Data type: Client Connection (the share of the commands one connection sends, and how it went)
+struct ClientConnection
+{
+    const char* socketPath;
+    char** lines;
+    long long* latencies;
+    int first;
+    int stride;
+    int count;
+    int failed;
+    int isEcho;
+    int isBroken;
+    int isStarted;
+    pthread_t thread;
+};
+
+
+//////////////////////////////////////
+// CLIENT HELPER FUNCTIONS
+//////////////////////////////////////
+
+// Current monotonic time in nanoseconds
+static long long clockNanoseconds(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+// Compare two latencies (for qsort)
+static int compareLatencies(const void* a, const void* b)
+{
+    long long left = *(const long long*)a, right = *(const long long*)b;
+
+    return (left > right) - (left < right);
+}
+
+// Connect to the server socket (returns -1 on failure)
+static int connectServer(const char* socketPath)
+{
+    struct sockaddr_un address;
+    int fd = -1;
+
+    if (strlen(socketPath) >= sizeof(address.sun_path))
+        return -1;
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socketPath);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd != -1 && connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+
+    return fd;
+}
+
+// Send a whole command line and its line break (returns 1 on success, 0 on failure)
+static int sendLine(int fd, const char* line)
+{
+    size_t length = strlen(line);
+    ssize_t sent = 0;
+
+    while (length > 0)
+    {
+        sent = send(fd, line, length, MSG_NOSIGNAL);
+        if (sent > 0)
+        {
+            line += sent;
+            length -= (size_t)sent;
+        }
+        else if (sent == 0 || errno != EINTR)
+            return 0;
+    }
+
+    return send(fd, "\n", 1, MSG_NOSIGNAL) == 1;
+}
+
+// Check if a reply line is a command's result line rather than one of its rows
+static int isResultLine(const char* line)
+{
+    return (strncmp(line, "ok", 2) == 0 && (line[2] == '\n' || line[2] == '|')) ||
+           strncmp(line, "error|", 6) == 0;
+}
+
+// Connection thread: send every stride-th command and time each reply
+static void* runConnection(void* arg)
+{
+    struct ClientConnection* conn = arg;
+    char reply[BATCH_LINE_LEN * 4];
+    long long started = 0;
+    int fd = connectServer(conn->socketPath), i = 0, isDone = 0;
+    FILE* replies = fd != -1 ? fdopen(fd, "r") : NULL;
+
+    if (replies == NULL)
+    {
+        if (fd != -1)
+            close(fd);
+        conn->isBroken = 1;
+        return NULL;
+    }
+
+    for (i = conn->first; i < conn->count && !conn->isBroken; i += conn->stride)
+    {
+        started = clockNanoseconds();
+        if (!sendLine(fd, conn->lines[i]))
+            conn->isBroken = 1;
+
+        // Rows come first and the result line last; a row longer than the buffer arrives in pieces
+        for (isDone = 0; !conn->isBroken && !isDone;)
+        {
+            if (fgets(reply, sizeof(reply), replies) == NULL)
+                conn->isBroken = 1;
+            else
+            {
+                isDone = isResultLine(reply);
+                if (isDone && reply[0] == 'e')
+                    conn->failed++;
+                if (conn->isEcho)
+                    fputs(reply, stdout);
+            }
+        }
+
+        conn->latencies[i] = clockNanoseconds() - started;
+    }
+
+    fclose(replies);
+
+    return NULL;
+}
+
+// Read the command lines to send, skipping blank and comment lines (returns # read, -1 if out of memory)
+static int readLines(FILE* input, char*** lines)
+{
+    char* line = NULL;
+    size_t size = 0;
+    ssize_t length = 0;
+    int count = 0, capacity = 0;
+
+    *lines = NULL;
+    while ((length = getline(&line, &size, input)) != -1)
+    {
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+            line[--length] = '\0';
+        if (length == 0 || line[0] == '#')
+            continue;
+
+        if (!growArray((void**)lines, &capacity, count + 1, sizeof(char*)) ||
+            ((*lines)[count] = strdup(line)) == NULL)
+        {
+            while (count > 0)
+                free((*lines)[--count]);
+            count = -1;
+            break;
+        }
+        count++;
+    }
+    free(line);
+
+    return count;
+}
+
+
+//////////////////////////////////////
+// CLIENT FUNCTIONS
+//////////////////////////////////////
+
+// Send the batch commands read from a stream to a server over 'clients' connections and report latency (returns # of failed commands, -1 if it could not run)
+int runClient(FILE* input, const char* socketPath, int clients)
+{
+    struct ClientConnection* conns = NULL;
+    long long* latencies = NULL;
+    char** lines = NULL;
+    long long started = 0, elapsed = 0;
+    int count = readLines(input, &lines), i = 0, failed = 0, isBroken = 0;
+    double seconds = 0.0;
+
+    if (clients < 1)
+        clients = 1;
+    if (clients > CLIENT_MAX_CONNECTIONS)
+        clients = CLIENT_MAX_CONNECTIONS;
+    if (count >= 0 && clients > count)
+        clients = count > 0 ? count : 1;
+
+    conns = calloc((size_t)clients, sizeof(*conns));
+    latencies = calloc(count > 0 ? (size_t)count : 1, sizeof(*latencies));
+    if (count < 0 || conns == NULL || latencies == NULL)
+    {
+        fprintf(stderr, "ERROR: Out of memory reading the commands\n");
+        failed = -1;
+    }
+    else
+    {
+        started = clockNanoseconds();
+        for (i = 0; i < clients; i++)
+        {
+            conns[i].socketPath = socketPath;
+            conns[i].lines = lines;
+            conns[i].latencies = latencies;
+            conns[i].first = i;
+            conns[i].stride = clients;
+            conns[i].count = count;
+            conns[i].isEcho = clients == 1;
+            conns[i].isStarted = pthread_create(&conns[i].thread, NULL, runConnection, &conns[i]) == 0;
+            if (!conns[i].isStarted)
+                conns[i].isBroken = 1;
+        }
+        for (i = 0; i < clients; i++)
+        {
+            if (conns[i].isStarted)
+                pthread_join(conns[i].thread, NULL);
+            failed += conns[i].failed;
+            isBroken |= conns[i].isBroken;
+        }
+        elapsed = clockNanoseconds() - started;
+
+        if (isBroken)
+        {
+            fprintf(stderr, "ERROR: Lost the connection to the server on %s\n", socketPath);
+            failed = -1;
+        }
+        else
+        {
+            qsort(latencies, (size_t)count, sizeof(*latencies), compareLatencies);
+            seconds = (double)elapsed / 1e9;
+            fprintf(stderr, "Ran %d commands over %d connections in %.3f s (%.0f commands/s)\n",
+                    count, clients, seconds, seconds > 0.0 ? count / seconds : 0.0);
+            if (count > 0)
+                fprintf(stderr, "Latency (us): p50 %.1f, p99 %.1f, max %.1f\n",
+                        latencies[count / 2] / 1e3, latencies[(count - 1) * 99 / 100] / 1e3,
+                        latencies[count - 1] / 1e3);
+        }
+    }
+
+    for (i = 0; i < count; i++)
+        free(lines[i]);
+    free(lines);
+    free(latencies);
+    free(conns);
+
+    return failed;
+}
+
+#else
+
+// Send the batch commands read from a stream to a server over 'clients' connections and report latency (returns # of failed commands, -1 if it could not run)
+int runClient(FILE* input, const char* socketPath, int clients)
+{
+    (void)input;
+    (void)socketPath;
+    (void)clients;
+    fprintf(stderr, "ERROR: Client mode needs Unix domain sockets\n");
+
+    return -1;
+}
+
+#endif
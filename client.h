@@ -0,0 +1,16 @@
+#ifndef CLIENT_H
+#define CLIENT_H
+
+#include <stdio.h>
+
+// Most connections one client run opens
+#define CLIENT_MAX_CONNECTIONS 256
+
+//////////////////////////////////////
+// CLIENT FUNCTIONS
+//////////////////////////////////////
+
+// Send the batch commands read from a stream to a server over 'clients' connections and report latency (returns # of failed commands, -1 if it could not run)
+int runClient(FILE* input, const char* socketPath, int clients);
+
+#endif // !CLIENT_H
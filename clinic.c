@@ -2,6 +2,9 @@
 Clinic module
 - Display functions
 - Menu & Item selection functions
+- Record functions (validated, journaled changes shared with batch mode)
+- Packed record functions (convert phones and appointments between their
+  stored and text forms)
 - User input functions
 - File functions
 - Utility functions
@@ -10,10 +13,277 @@ Clinic module
 #define _CRT_SECURE_NO_WARNINGS
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "core.h"
 #include "clinic.h"
+#include "loader.h"
+#include "render.h"
+#include "stats.h"
+#include "store.h"
+
+
+// Radix sort digit size
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+
+// Reused by every table view (rows are written out in RENDER_BUFFER_SIZE blocks)
+static struct RenderBuffer tableOutput;
+
+// Data type: Sort Item (sort key and the appointment it came from)
+struct SortItem
+{
+    unsigned long long key;
+    int index;
+};
+
+
+//////////////////////////////////////
+// SORT HELPER FUNCTIONS
+//////////////////////////////////////
+
+// LSD radix sort of packed keys (skips digits every key shares)
+static void radixSortItems(struct SortItem* items, struct SortItem* buffer, int count)
+{
+    int counts[RADIX_BUCKETS] = { 0 };
+    int i = 0, bucket = 0, offset = 0, shift = 0;
+    struct SortItem* from = items;
+    struct SortItem* to = buffer;
+    struct SortItem* swap = NULL;
+
+    for (shift = 0; shift < 64; shift += RADIX_BITS)
+    {
+        memset(counts, 0, sizeof(counts));
+        for (i = 0; i < count; i++)
+            counts[(from[i].key >> shift) & (RADIX_BUCKETS - 1)]++;
+
+        if (counts[(from[0].key >> shift) & (RADIX_BUCKETS - 1)] != count)
+        {
+            offset = 0;
+            for (bucket = 0; bucket < RADIX_BUCKETS; bucket++)
+            {
+                i = counts[bucket];
+                counts[bucket] = offset;
+                offset += i;
+            }
+
+            for (i = 0; i < count; i++)
+                to[counts[(from[i].key >> shift) & (RADIX_BUCKETS - 1)]++] = from[i];
+
+            swap = from;
+            from = to;
+            to = swap;
+        }
+    }
+
+    if (from != items)
+        memcpy(items, from, (size_t)count * sizeof(struct SortItem));
+}
+
+// In-place insertion sort of appointments (used when no scratch memory is available)
+static void insertionSortAppointments(struct Appointment* appointments, int count)
+{
+    int i = 0, j = 0;
+    struct Appointment current = { 0 };
+
+    for (i = 1; i < count; i++)
+    {
+        current = appointments[i];
+        for (j = i; j > 0 && compareAppointments(&current, &appointments[j - 1]) < 0; j--)
+            appointments[j] = appointments[j - 1];
+        appointments[j] = current;
+    }
+}
+
+
+//////////////////////////////////////
+// NAME SEARCH HELPER FUNCTIONS
+//////////////////////////////////////
+
+// Typos a fuzzy name search forgives in a query word (each typo changes at most 4 of its trigrams,
+// so a word needs 4 * typos + 1 of them for the index to find every match)
+static int nameTypos(int length)
+{
+    return length < 4 ? 0 : length < 8 ? 1 : 2;
+}
+
+// Count the edits (insert, delete, change or swap two neighbours) between two words, stopping at limit + 1
+static int wordDistance(const char* a, int aLength, const char* b, int bLength, int limit)
+{
+    int rows[3][NAME_INDEX_TRIGRAMS + 1];
+    int* before = rows[0];
+    int* previous = rows[1];
+    int* current = rows[2];
+    int* spare = NULL;
+    int i = 0, j = 0, best = 0, cost = 0;
+
+    if (aLength - bLength > limit || bLength - aLength > limit ||
+        aLength >= NAME_INDEX_TRIGRAMS || bLength >= NAME_INDEX_TRIGRAMS)
+        return limit + 1;
+
+    for (j = 0; j <= bLength; j++)
+        previous[j] = j;
+
+    for (i = 1; i <= aLength; i++)
+    {
+        current[0] = best = i;
+        for (j = 1; j <= bLength; j++)
+        {
+            cost = a[i - 1] != b[j - 1];
+            current[j] = previous[j - 1] + cost;
+            if (previous[j] + 1 < current[j])
+                current[j] = previous[j] + 1;
+            if (current[j - 1] + 1 < current[j])
+                current[j] = current[j - 1] + 1;
+            if (i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1] &&
+                before[j - 2] + 1 < current[j])
+                current[j] = before[j - 2] + 1;
+            if (current[j] < best)
+                best = current[j];
+        }
+
+        // Every later row is at least the smallest value of this one
+        if (best > limit)
+            return limit + 1;
+
+        spare = before;
+        before = previous;
+        previous = current;
+        current = spare;
+    }
+
+    return previous[bLength] <= limit ? previous[bLength] : limit + 1;
+}
+
+// Check if a normalized name has a word starting with a normalized query (which may span words)
+static int isNamePrefix(const char* name, const char* query, int queryLength)
+{
+    while (name != NULL)
+    {
+        if (strncmp(name, query, (size_t)queryLength) == 0)
+            return 1;
+        name = strchr(name, ' ');
+        if (name != NULL)
+            name++;
+    }
+
+    return 0;
+}
+
+// Check if each word of a normalized query is within its typos of a word of a normalized name
+static int isNameNear(const char* name, const char* query)
+{
+    const char* word = NULL;
+    int queryLength = 0, wordLength = 0, isFound = 1;
+
+    while (isFound && *query != '\0')
+    {
+        queryLength = (int)strcspn(query, " ");
+        isFound = 0;
+        for (word = name; !isFound && *word != '\0'; word += wordLength + (word[wordLength] == ' '))
+        {
+            wordLength = (int)strcspn(word, " ");
+            isFound = wordDistance(query, queryLength, word, wordLength,
+                                   nameTypos(queryLength)) <= nameTypos(queryLength);
+        }
+        query += queryLength + (query[queryLength] == ' ');
+    }
+
+    return isFound;
+}
+
+// Put found slots in slot order (few enough for an insertion sort)
+static void sortSlots(int* slots, int count)
+{
+    int i = 0, j = 0, slot = 0;
+
+    for (i = 1; i < count; i++)
+    {
+        slot = slots[i];
+        for (j = i; j > 0 && slots[j - 1] > slot; j--)
+            slots[j] = slots[j - 1];
+        slots[j] = slot;
+    }
+}
+
+// Get the patient an appointment is for, or if the data files booked it for a patient that
+// does not exist, a blank stand-in with just the patient number filled in
+static const struct Patient* appointmentPatient(const struct ClinicData* data, const struct Appointment* appoint,
+                                                struct Patient* missing)
+{
+    int index = findPatientIndexByPatientNum(appoint->patientNumber, data);
+
+    if (index != -1)
+        return &data->patients[index];
+
+    memset(missing, 0, sizeof(*missing));
+    missing->patientNumber = appoint->patientNumber;
+
+    return missing;
+}
+
+// Choose the trigram chains that hold every match of a normalized query (returns # of chains,
+// -1 if only a scan of every name finds them all)
+static int chooseNameChains(const struct NameIndex* index, const char* query, int isFuzzy, int* chains)
+{
+    char word[NAME_INDEX_TRIGRAMS] = { 0 };
+    int trigrams[NAME_INDEX_TRIGRAMS], counts[NAME_INDEX_TRIGRAMS];
+    int count = 0, needed = 0, total = 0, bestTotal = -1, bestCount = -1, length = 0, i = 0, j = 0;
+    int trigram = 0, trigramCount = 0;
+
+    // A prefix match holds every trigram of the query, so its rarest one's chain holds them all
+    if (!isFuzzy)
+    {
+        count = nameTrigrams(query, 1, trigrams);
+        for (i = 0; i < count; i++)
+        {
+            if (i == 0 || nameIndexCount(index, trigrams[i]) < nameIndexCount(index, chains[0]))
+                chains[0] = trigrams[i];
+        }
+        return count > 0 ? 1 : 0;
+    }
+
+    // A near match of a query word keeps at least one of any 4 * typos + 1 of its trigrams,
+    // so the rarest ones of the word with the shortest such chains are enough
+    while (*query != '\0')
+    {
+        length = (int)strcspn(query, " ");
+        memcpy(word, query, (size_t)length);
+        word[length] = '\0';
+        query += length + (query[length] == ' ');
+
+        count = nameTrigrams(word, 0, trigrams);
+        needed = 4 * nameTypos(length) + 1;
+        if (count < needed)
+            continue;
+
+        // Insertion sort by chain length
+        for (i = 0; i < count; i++)
+        {
+            trigram = trigrams[i];
+            trigramCount = nameIndexCount(index, trigram);
+            for (j = i; j > 0 && counts[j - 1] > trigramCount; j--)
+            {
+                trigrams[j] = trigrams[j - 1];
+                counts[j] = counts[j - 1];
+            }
+            trigrams[j] = trigram;
+            counts[j] = trigramCount;
+        }
+
+        for (i = 0, total = 0; i < needed; i++)
+            total += counts[i];
+        if (bestTotal == -1 || total < bestTotal)
+        {
+            bestTotal = total;
+            bestCount = needed;
+            memcpy(chains, trigrams, (size_t)needed * sizeof(int));
+        }
+    }
+
+    return bestCount;
+}
 
 
 //////////////////////////////////////
@@ -30,20 +300,24 @@ void displayPatientTableHeader(void)
 // Displays a single patient record in FMT_FORM | FMT_TABLE format
 void displayPatientData(const struct Patient* patient, int fmt)
 {
+    struct Phone phone = { 0 };
+
+    unpackPhone(patient, &phone);
+
     if (fmt == FMT_FORM)
     {
         printf("Name  : %s\n"
                "Number: %05d\n"
                "Phone : ", patient->name, patient->patientNumber);
-        displayFormattedPhone(patient->phone.number);
-        printf(" (%s)\n", patient->phone.description);
+        displayFormattedPhone(phone.number);
+        printf(" (%s)\n", phone.description);
     }
     else
     {
         printf("%05d %-15s ", patient->patientNumber,
                patient->name);
-        displayFormattedPhone(patient->phone.number);
-        printf(" (%s)\n", patient->phone.description);
+        displayFormattedPhone(phone.number);
+        printf(" (%s)\n", phone.description);
     }
 }
 
@@ -55,33 +329,202 @@ void displayScheduleTableHeader(const struct Date* date, int isAllRecords)
     if (isAllRecords)
     {
         printf("<ALL>\n\n");
-        printf("Date       Time  Pat.# Name            Phone#\n"
-               "---------- ----- ----- --------------- --------------------\n");
+        printf("Date       Time  Rm Min Pat.# Name            Phone#\n"
+               "---------- ----- -- --- ----- --------------- --------------------\n");
     }
     else
     {
         printf("%04d-%02d-%02d\n\n", date->year, date->month, date->day);
-        printf("Time  Pat.# Name            Phone#\n"
-               "----- ----- --------------- --------------------\n");
+        printf("Time  Rm Min Pat.# Name            Phone#\n"
+               "----- -- --- ----- --------------- --------------------\n");
     }
 }
 
+// Display's the appointment schedule header for the dates from 'from' to 'to'
+void displayRangeTableHeader(const struct Date* from, const struct Date* to)
+{
+    printf("Clinic Appointments for the Dates: %04d-%02d-%02d to %04d-%02d-%02d\n\n",
+           from->year, from->month, from->day, to->year, to->month, to->day);
+    printf("Date       Time  Rm Min Pat.# Name            Phone#\n"
+           "---------- ----- -- --- ----- --------------- --------------------\n");
+}
+
 // Display a single appointment record with patient info. in tabular format
 void displayScheduleData(const struct Patient* patient,
                          const struct Appointment* appoint,
                          int includeDateField)
 {
+    struct Date date = { 0 };
+    struct Time time = { 0 };
+    struct Phone phone = { 0 };
+
+    unpackAppointment(appoint, &date, &time);
+    unpackPhone(patient, &phone);
+
     if (includeDateField)
     {
-        printf("%04d-%02d-%02d ", appoint->date.year, appoint->date.month,
-               appoint->date.day);
+        printf("%04d-%02d-%02d ", date.year, date.month,
+               date.day);
+    }
+    printf("%02d:%02d %2d %3d %05d %-15s ", time.hour, time.min, appoint->room,
+           visitMinutes(appoint), patient->patientNumber, patient->name);
+
+    displayFormattedPhone(phone.number);
+
+    printf(" (%s)\n", phone.description);
+}
+
+// Display the first free visits of 'length' timeslots on or after a date (in one room, or any if 0)
+void displayFreeTimeslots(const struct ClinicData* data, const struct Date* from, int room, int length)
+{
+    struct Appointment found[FREE_TIMESLOT_OFFERS];
+    struct Date date = { 0 };
+    struct Time time = { 0 };
+    int count = findFreeTimeslots(data, from, NULL, NULL, room, length, found, FREE_TIMESLOT_OFFERS), i = 0;
+
+    if (count > 0)
+    {
+        printf("Next available timeslots:\n");
+        for (i = 0; i < count; i++)
+        {
+            unpackAppointment(&found[i], &date, &time);
+            printf("%04d-%02d-%02d %02d:%02d Room %d\n", date.year, date.month, date.day,
+                   time.hour, time.min, found[i].room);
+        }
+        printf("\n");
+    }
+}
+
+// Display the patients with a phone number (tabular)
+void displayPatientsByPhone(const struct ClinicData* data, long long phoneKey)
+{
+    int slot = -1, found = 0;
+    STATS_START(started);
+
+    displayPatientTableHeader();
+    slot = multiIndexFirst(&data->phoneIndex, phoneKey);
+    while (slot != -1)
+    {
+        found += 1;
+        renderPatientRow(&tableOutput, &data->patients[slot]);
+        slot = multiIndexNext(&data->phoneIndex, slot);
+    }
+
+    if (!found)
+        renderText(&tableOutput, "\n*** No records found ***\n");
+
+    renderText(&tableOutput, "\n");
+    renderFlush(&tableOutput);
+    STATS_STOP(STATS_FIND_PHONE, started, found);
+}
+
+// Display the patients with a name word starting with a search, or failing that names close to it (tabular)
+void displayPatientsByName(const struct ClinicData* data, const char* query)
+{
+    int slots[NAME_SEARCH_LIMIT];
+    int count = findPatientsByName(data, query, 0, slots, NAME_SEARCH_LIMIT), i = 0;
+
+    if (count == 0)
+    {
+        count = findPatientsByName(data, query, 1, slots, NAME_SEARCH_LIMIT);
+        if (count > 0)
+            printf("No names start with \"%s\"; similar names:\n\n", query);
+    }
+
+    displayPatientTableHeader();
+    for (i = 0; i < count; i++)
+        renderPatientRow(&tableOutput, &data->patients[slots[i]]);
+
+    if (count == 0)
+        renderText(&tableOutput, "\n*** No records found ***\n");
+    renderFlush(&tableOutput);
+
+    if (count == NAME_SEARCH_LIMIT)
+        printf("(the %d most recently named matches; type more of the name to narrow them)\n", NAME_SEARCH_LIMIT);
+    printf("\n");
+}
+
+// Display the appointment schedule for a date
+void displayAppointmentSchedule(const struct ClinicData* data, const struct Date* date)
+{
+    struct Patient missing;
+    int i = 0, slot = 0, count = 0;
+    int day = dayKeyFromDate(date->year, date->month, date->day), first = storeFirstAppointmentOnDay(data, day);
+    STATS_START(started);
+
+    displayScheduleTableHeader(date, 0);
+
+    // The day's appointments are a sorted run in the store
+    for (i = first; isAppointmentOnDay(data, i, day); i++)
+    {
+        slot = storeAppointmentAt(data, i);
+        if (slot != -1)
+        {
+            renderScheduleRow(&tableOutput, appointmentPatient(data, &data->appointments[slot], &missing),
+                              &data->appointments[slot], 0);
+            count++;
+        }
+    }
+
+    if (count == 0)
+        renderText(&tableOutput, "No appointments\n");
+
+    renderText(&tableOutput, "\n");
+    renderFlush(&tableOutput);
+    STATS_STOP(STATS_VIEW_SCHEDULE, started, i - first);
+}
+
+// Display the appointments from one date to another (both included)
+void displayAppointmentRange(const struct ClinicData* data, const struct Date* from, const struct Date* to)
+{
+    struct Patient missing;
+    int i = 0, slot = 0, count = 0, first = 0, end = 0;
+    STATS_START(started);
+
+    first = findAppointmentRange(data, from, to, &end);
+    displayRangeTableHeader(from, to);
+
+    // Only the slice between the two ends is visited
+    for (i = first; i < end; i++)
+    {
+        slot = storeAppointmentAt(data, i);
+        if (slot != -1)
+        {
+            renderScheduleRow(&tableOutput, appointmentPatient(data, &data->appointments[slot], &missing),
+                              &data->appointments[slot], 1);
+            count++;
+        }
     }
-    printf("%02d:%02d %05d %-15s ", appoint->time.hour, appoint->time.min,
-           patient->patientNumber, patient->name);
 
-    displayFormattedPhone(patient->phone.number);
+    if (count == 0)
+        renderText(&tableOutput, "No appointments\n");
+
+    renderText(&tableOutput, "\n");
+    renderFlush(&tableOutput);
+    STATS_STOP(STATS_VIEW_RANGE, started, end - first);
+}
+
+// Display a patient's appointments in date/time order (tabular)
+void displayPatientAppointments(const struct ClinicData* data, const struct Patient* patient)
+{
+    int slots[PATIENT_APPOINTMENT_LIMIT];
+    int count = findPatientAppointments(data, patient->patientNumber, slots, PATIENT_APPOINTMENT_LIMIT), i = 0;
+
+    printf("Clinic Appointments for the Patient: %05d %s\n\n", patient->patientNumber, patient->name);
+    printf("Date       Time  Rm Min Pat.# Name            Phone#\n"
+           "---------- ----- -- --- ----- --------------- --------------------\n");
 
-    printf(" (%s)\n", patient->phone.description);
+    for (i = 0; i < count && i < PATIENT_APPOINTMENT_LIMIT; i++)
+        renderScheduleRow(&tableOutput, patient, &data->appointments[slots[i]], 1);
+
+    if (count == 0)
+        renderText(&tableOutput, "No appointments\n");
+
+    renderText(&tableOutput, "\n");
+    renderFlush(&tableOutput);
+
+    if (count > PATIENT_APPOINTMENT_LIMIT)
+        printf("(first %d of %d appointments)\n\n", PATIENT_APPOINTMENT_LIMIT, count);
 }
 
 
@@ -117,7 +560,7 @@ void menuMain(struct ClinicData* data)
             }
             break;
         case 1:
-            menuPatient(data->patients, data->maxPatient);
+            menuPatient(data);
             break;
         case 2:
             menuAppointment(data);
@@ -127,7 +570,7 @@ void menuMain(struct ClinicData* data)
 }
 
 // Menu: Patient Management
-void menuPatient(struct Patient patient[], int max)
+void menuPatient(struct ClinicData* data)
 {
     int selection;
 
@@ -148,21 +591,21 @@ void menuPatient(struct Patient patient[], int max)
         switch (selection)
         {
         case 1:
-            displayAllPatients(patient, max, FMT_TABLE);
+            displayAllPatients(data->patients, data->patientCount, FMT_TABLE);
             suspend();
             break;
         case 2:
-            searchPatientData(patient, max);
+            searchPatientData(data);
             break;
         case 3:
-            addPatient(patient, max);
+            addPatient(data);
             suspend();
             break;
         case 4:
-            editPatient(patient, max);
+            editPatient(data);
             break;
         case 5:
-            removePatient(patient, max);
+            removePatient(data);
             suspend();
             break;
         }
@@ -170,17 +613,22 @@ void menuPatient(struct Patient patient[], int max)
 }
 
 // Menu: Patient edit
-void menuPatientEdit(struct Patient* patient)
+void menuPatientEdit(struct ClinicData* data, int index)
 {
     int selection;
+    struct Patient* patient = &data->patients[index];
+    struct Patient edited = { 0 };
+    struct Phone phone = { 0 };
 
     do {
+        unpackPhone(patient, &phone);
+
         printf("Edit Patient (%05d)\n"
                "=========================\n"
                "1) NAME : %s\n"
                "2) PHONE: ", patient->patientNumber, patient->name);
         
-        displayFormattedPhone(patient->phone.number);
+        displayFormattedPhone(phone.number);
         
         printf("\n"
                "-------------------------\n"
@@ -189,18 +637,26 @@ void menuPatientEdit(struct Patient* patient)
                "Selection: ");
         selection = inputIntRange(0, 2);
         putchar('\n');
+        edited = *patient;
 
         if (selection == 1)
         {
             printf("Name  : ");
-            inputCString(patient->name, 1, NAME_LEN);
+            inputCString(edited.name, 1, NAME_LEN);
             putchar('\n');
-            printf("Patient record updated!\n\n");
+            if (updatePatientRecord(data, index, &edited))
+                printf("Patient record updated!\n\n");
+            else
+                printf("ERROR: Patient record could not be updated!\n\n");
         }
         else if (selection == 2)
         {
-            inputPhoneData(&patient->phone);
-            printf("Patient record updated!\n\n");
+            inputPhoneData(&phone);
+            packPhone(&edited, &phone);
+            if (updatePatientRecord(data, index, &edited))
+                printf("Patient record updated!\n\n");
+            else
+                printf("ERROR: Patient record could not be updated!\n\n");
         }
 
     } while (selection);
@@ -218,11 +674,13 @@ void menuAppointment(struct ClinicData* data)
                "2) VIEW   Appointments by DATE\n"
                "3) ADD    Appointment\n"
                "4) REMOVE Appointment\n"
+               "5) VIEW   Appointments by DATE RANGE\n"
+               "6) VIEW   Appointments by PATIENT\n"
                "------------------------------\n"
                "0) Previous menu\n"
                "------------------------------\n"
                "Selection: ");
-        selection = inputIntRange(0, 4);
+        selection = inputIntRange(0, 6);
         putchar('\n');
         switch (selection)
         {
@@ -235,13 +693,19 @@ void menuAppointment(struct ClinicData* data)
             suspend();
             break;
         case 3:
-            addAppointment(data->appointments, data->maxAppointments,
-                           data->patients, data->maxPatient);
+            addAppointment(data);
             suspend();
             break;
         case 4:
-            removeAppointment(data->appointments, data->maxAppointments,
-                              data->patients, data->maxPatient);
+            removeAppointment(data);
+            suspend();
+            break;
+        case 5:
+            viewAppointmentRange(data);
+            suspend();
+            break;
+        case 6:
+            viewPatientAppointments(data);
             suspend();
             break;
         }
@@ -249,25 +713,35 @@ void menuAppointment(struct ClinicData* data)
 }
 
 // Display's all patient data in the FMT_FORM | FMT_TABLE format
-void displayAllPatients(const struct Patient patient[], int max, int fmt)
+void displayAllPatients(const struct Patient patient[], int count, int fmt)
 {
     int i = 0, noRecords = 0;
+    STATS_START(started);
 
     displayPatientTableHeader();
-    for (i = 0; i < max; i++)
-        if (strcmp(patient[i].name, ""))
-            displayPatientData(&patient[i], fmt);
-        else
+    for (i = 0; i < count; i++)
+    {
+        if (!strcmp(patient[i].name, ""))
             noRecords++;
+        else if (fmt == FMT_TABLE)
+            renderPatientRow(&tableOutput, &patient[i]);
+        else
+        {
+            renderFlush(&tableOutput);
+            displayPatientData(&patient[i], fmt);
+        }
+    }
 
-    if (noRecords == max)
-        printf("*** No records found ***\n");
+    if (noRecords == count)
+        renderText(&tableOutput, "*** No records found ***\n");
 
-    printf("\n");
+    renderText(&tableOutput, "\n");
+    renderFlush(&tableOutput);
+    STATS_STOP(STATS_VIEW_PATIENTS, started, count);
 }
 
 // Search for a patient record based on patient number or phone number
-void searchPatientData(const struct Patient patient[], int max)
+void searchPatientData(const struct ClinicData* data)
 {
     int selection = 0;
     do
@@ -276,56 +750,49 @@ void searchPatientData(const struct Patient patient[], int max)
         printf("==========================\n");
         printf("1) By patient number\n");
         printf("2) By phone number\n");
+        printf("3) By name\n");
         printf("..........................\n");
         printf("0) Previous menu\n");
         printf("..........................\n");
         printf("Selection: ");
-        selection = inputIntRange(0, 2);
+        selection = inputIntRange(0, 3);
         printf("\n");
 
         switch (selection)
         {
             case 1:
-                searchPatientByPatientNumber(patient, max);
+                searchPatientByPatientNumber(data);
                 break;
 
             case 2:
-                searchPatientByPhoneNumber(patient, max);
+                searchPatientByPhoneNumber(data);
+                break;
+
+            case 3:
+                searchPatientByName(data);
                 break;
         }
     } while (selection);
 }
 
 // Add a new patient record to the patient array
-void addPatient(struct Patient patient[], int max)
+void addPatient(struct ClinicData* data)
 {
-    int i = 0, freeRecord = 0;
+    struct Patient patient = { 0 };
 
-    while (i < max)
-    {
-        if (patient[i].patientNumber == 0)
-        {
-            freeRecord = i;
-            i = max;
-        }
-        else
-            i++;
-    }
+    patient.patientNumber = nextPatientNumber(data);
+    inputPatient(&patient);
 
-    if (freeRecord == 0)
-        printf("ERROR: Patient listing is FULL!\n");
-    else
-    {
-        patient[freeRecord].patientNumber = nextPatientNumber(patient, max);
-        inputPatient(&patient[freeRecord]);
+    if (addPatientRecord(data, &patient) != -1)
         printf("*** New patient record added ***\n");
-    }
+    else
+        printf("ERROR: Patient record could not be added!\n");
 
     printf("\n");
 }
 
 // Edit a patient record from the patient array
-void editPatient(struct Patient patient[], int max)
+void editPatient(struct ClinicData* data)
 {
     int number = 0, index = 0;
 
@@ -333,26 +800,26 @@ void editPatient(struct Patient patient[], int max)
     number = inputIntPositive();
     printf("\n");
 
-    index = findPatientIndexByPatientNum(number, patient, max);
+    index = findPatientIndexByPatientNum(number, data);
 
-    index != -1 ? menuPatientEdit(&patient[index]) : printf("ERROR: Patient record not found!\n");
+    index != -1 ? menuPatientEdit(data, index) : printf("ERROR: Patient record not found!\n");
 }
 
 // Remove a patient record from the patient array
-void removePatient(struct Patient patient[], int max)
+void removePatient(struct ClinicData* data)
 {
-    int number = 0, index = 0;
+    int number = 0, index = 0, cancelled = 0;
     char removeRecordInput = '\0';
 
     printf("Enter the patient number: ");
     number = inputIntPositive();
     printf("\n");
 
-    index = findPatientIndexByPatientNum(number, patient, max);
+    index = findPatientIndexByPatientNum(number, data);
 
     if (index != -1)
     {
-        displayPatientData(&patient[index], FMT_FORM);
+        displayPatientData(&data->patients[index], FMT_FORM);
         printf("\n");
         printf("Are you sure you want to remove this patient record? (y/n): ");
         removeRecordInput = inputCharOption("yn");
@@ -360,11 +827,13 @@ void removePatient(struct Patient patient[], int max)
         switch (removeRecordInput)
         {
         case 'y':
-            patient[index].patientNumber = 0;
-            strcpy(patient[index].name, "");
-            strcpy(patient[index].phone.description, "");
-            strcpy(patient[index].phone.number, "");
-            printf("Patient record has been removed!\n");
+            cancelled = removePatientRecord(data, index);
+            if (cancelled == -1)
+                printf("ERROR: Patient record could not be removed!\n");
+            else
+                printf("Patient record has been removed!\n");
+            if (cancelled > 0)
+                printf("Their %d appointment(s) have been removed too.\n", cancelled);
             break;
 
         case 'n':
@@ -380,164 +849,142 @@ void removePatient(struct Patient patient[], int max)
 // View ALL scheduled appointments
 void viewAllAppointments(struct ClinicData* data)
 {
-    int i = 0;
-    int minPatientIndex = 0;
-    int totalAppointments = 0;
-    struct Appointment sortedAppointments[MAX_APPOINTMENTS] = { {0} };
-
-    while (data->appointments[i].patientNumber != 0)
-    {
-        sortedAppointments[i].patientNumber = data->appointments[i].patientNumber;
-        sortedAppointments[i].date.year = data->appointments[i].date.year;
-        sortedAppointments[i].date.month = data->appointments[i].date.month;
-        sortedAppointments[i].date.day = data->appointments[i].date.day;
-        sortedAppointments[i].time.hour = data->appointments[i].time.hour;
-        sortedAppointments[i].time.min = data->appointments[i].time.min;
-        i++;
-    }
-    totalAppointments = i;
-
-    sortAppointments(sortedAppointments, totalAppointments);
+    struct Patient missing;
+    int i = 0, slot = 0;
+    STATS_START(started);
 
-    displayScheduleTableHeader(&data->appointments->date, 1);
-    for (i = 0; i < totalAppointments; i++)
+    displayScheduleTableHeader(NULL, 1);
+    for (i = 0; i < data->appointmentOrderCount; i++)
     {
-        minPatientIndex = findPatientIndexByPatientNum(sortedAppointments[i].patientNumber, data->patients, data->maxPatient);
-        displayScheduleData(&data->patients[minPatientIndex], &sortedAppointments[i], 1);
+        slot = storeAppointmentAt(data, i);
+        if (slot != -1)
+            renderScheduleRow(&tableOutput, appointmentPatient(data, &data->appointments[slot], &missing),
+                              &data->appointments[slot], 1);
     }
 
-    printf("\n");
+    renderText(&tableOutput, "\n");
+    renderFlush(&tableOutput);
+    STATS_STOP(STATS_VIEW_APPOINTMENTS, started, data->appointmentOrderCount);
 }
 
 
 // View appointment schedule for the user input date
 void viewAppointmentSchedule(struct ClinicData* data)
 {
-    int i = 0, scheduleTotal = 0, index = 0;
-
     struct Date schedule = { 0 };
-    struct Appointment scheduleAppoints[MAX_APPOINTMENTS] = { {0} };
 
     inputDate(&schedule);
-
     printf("\n");
 
-    for (i = 0; i < data->maxAppointments; i++)
-    {
-        if (data->appointments[i].date.year == schedule.year &&
-            data->appointments[i].date.month == schedule.month &&
-            data->appointments[i].date.day == schedule.day)
-        {
-            scheduleAppoints[scheduleTotal].date.year = data->appointments[i].date.year;
-            scheduleAppoints[scheduleTotal].date.month = data->appointments[i].date.month;
-            scheduleAppoints[scheduleTotal].date.day = data->appointments[i].date.day;
-            scheduleAppoints[scheduleTotal].patientNumber = data->appointments[i].patientNumber;
-            scheduleAppoints[scheduleTotal].time.hour = data->appointments[i].time.hour;
-            scheduleAppoints[scheduleTotal].time.min = data->appointments[i].time.min;
-
-            scheduleTotal++;
-        }
-    }
+    displayAppointmentSchedule(data, &schedule);
+}
 
-    displayScheduleTableHeader(&schedule, 0);
+// View the appointments of a user input patient
+void viewPatientAppointments(struct ClinicData* data)
+{
+    int number = 0, index = 0;
 
-    if (scheduleTotal > 0)
-    {
-        sortAppointments(scheduleAppoints, scheduleTotal);
-        for (i = 0; i < scheduleTotal; i++)
-        {
-            index = findPatientIndexByPatientNum(scheduleAppoints[i].patientNumber, data->patients, data->maxPatient);
+    printf("Patient Number: ");
+    number = inputIntPositive();
+    printf("\n");
 
-            displayScheduleData(&data->patients[index], &scheduleAppoints[i], 0);
-        }
+    index = findPatientIndexByPatientNum(number, data);
 
-    }
+    if (index != -1)
+        displayPatientAppointments(data, &data->patients[index]);
     else
-        printf("No appointments\n");
+        printf("ERROR: Patient record not found!\n\n");
+}
+
+// View the appointments between two user input dates
+void viewAppointmentRange(struct ClinicData* data)
+{
+    struct Date from = { 0 }, to = { 0 };
+    int isBefore = 0;
 
+    printf("From date\n");
+    inputDate(&from);
     printf("\n");
 
+    do {
+        printf("To date\n");
+        inputDate(&to);
+        printf("\n");
+
+        isBefore = dayKeyFromDate(to.year, to.month, to.day) < dayKeyFromDate(from.year, from.month, from.day);
+        if (isBefore)
+            printf("ERROR: The end date must not be before the start date!\n\n");
+    } while (isBefore);
+
+    displayAppointmentRange(data, &from, &to);
 }
 
 // Add an appointment record to the appointment array
-void addAppointment(struct Appointment* appointments, int maxAppointments, struct Patient* patients, int maxPatients)
+void addAppointment(struct ClinicData* data)
 {
-    int i = 0, available = 0, isPatient = 0, totalPatients = 0, totalAppointments = 0;
+    int available = 0, isPatient = 0, patientNumber = 0, room = 0, length = 0;
+    int rooms[CLINIC_ROOMS];
 
     struct Appointment timeslot = { 0 };
-
-    while (patients[totalPatients].patientNumber != 0)
-        totalPatients++;
-
-    while (appointments[totalAppointments].patientNumber != 0)
-        totalAppointments++;
+    struct Date date = { 0 };
+    struct Time time = { 0 };
 
     while (!isPatient)
     {
         printf("Patient Number: ");
-        timeslot.patientNumber = inputIntPositive();
+        patientNumber = inputIntPositive();
 
-        i = 0;
-        while (!isPatient && i < totalPatients)
-        {
-            if (patients[i].patientNumber == timeslot.patientNumber)
-            {
-                isPatient = 1;
-            }
-            else
-                i++;
-        }
+        isPatient = findPatientIndexByPatientNum(patientNumber, data) != -1;
 
         if (isPatient)
         {
+            printf("Room (0=any, 1-%d)    : ", CLINIC_ROOMS);
+            room = inputIntRange(0, CLINIC_ROOMS);
+            printf("Length (1-%d x %d min): ", TIMESLOTS_PER_DAY, APPOINTMENT_INTERVAL);
+            length = inputIntRange(1, TIMESLOTS_PER_DAY);
+
             while (!available)
             {
-                if (timeslot.date.year == 0)
-                    inputDate(&timeslot.date);
+                if (date.year == 0)
+                    inputDate(&date);
                 printf("Hour (0-23)  : ");
-                timeslot.time.hour = inputIntRange(0, 23);
+                time.hour = inputIntRange(0, 23);
                 printf("Minute (0-59): ");
-                timeslot.time.min = inputIntRange(0, 59);
+                time.min = inputIntRange(0, 59);
 
-                if (timeslot.time.hour >= MIN_HOUR && (timeslot.time.hour <= MAX_HOUR && timeslot.time.min == 0) && timeslot.time.min % APPOINTMENT_INTERVAL == 0)
+                if (!packAppointment(&timeslot, patientNumber, &date, &time) ||
+                    !packVisit(&timeslot, room == 0 ? 1 : room, length * APPOINTMENT_INTERVAL))
                 {
-                    i = 0;
-                    while (!available && i < totalAppointments)
-                    {
-                        if (appointments[i].date.year == timeslot.date.year &&
-                            appointments[i].date.month == timeslot.date.month &&
-                            appointments[i].date.day == timeslot.date.day)
-                        {
-                            if (appointments[i].time.hour != timeslot.time.hour)
-                                available = 1;
-                            else if (appointments[i].time.min != timeslot.time.min)
-                                available = 1;
-                            else
-                                i++;
-                        }
-                        else
-                            i++;
-                    }
+                    printf("\nERROR: Appointment date is out of range!\n\n");
+                    date.year = 0;
+                }
+                else if (!isAppointmentTime(&time))
+                    printf("ERROR: Time must be between %d:00 and %d:00 in %d minute intervals.\n\n", MIN_HOUR, MAX_HOUR, APPOINTMENT_INTERVAL);
+                else if (appointmentTimeslot(&timeslot) == -1)
+                    printf("ERROR: A %d minute visit must start by %02d:%02d.\n\n", length * APPOINTMENT_INTERVAL,
+                           MIN_HOUR + (TIMESLOTS_PER_DAY - length) * APPOINTMENT_INTERVAL / 60,
+                           (TIMESLOTS_PER_DAY - length) * APPOINTMENT_INTERVAL % 60);
+                else
+                {
+                    // Any room takes the first one free for the whole visit
+                    if (room == 0 && findFreeRooms(data, &timeslot, rooms) > 0)
+                        timeslot.room = (unsigned char)rooms[0];
+                    available = isTimeslotAvailable(data, &timeslot);
 
                     if (available)
                     {
-                        appointments[totalAppointments].date.year = timeslot.date.year;
-                        appointments[totalAppointments].date.month = timeslot.date.month;
-                        appointments[totalAppointments].date.day = timeslot.date.day;
-                        appointments[totalAppointments].patientNumber = timeslot.patientNumber;
-                        appointments[totalAppointments].time.hour = timeslot.time.hour;
-                        appointments[totalAppointments].time.min = timeslot.time.min;
-
-                        printf("\n*** Appointment scheduled! ***\n");
+                        if (addAppointmentRecord(data, &timeslot) != -1)
+                            printf("\n*** Appointment scheduled! ***\n");
+                        else
+                            printf("\nERROR: Appointment record could not be added!\n");
                     }
                     else
                     {
                         printf("\nERROR: Appointment timeslot is not available!\n\n");
-                        timeslot.date.year = 0;
+                        displayFreeTimeslots(data, &date, room, length);
+                        date.year = 0;
                     }
                 }
-                else
-                    printf("ERROR: Time must be between %d:00 and %d:00 in %d minute intervals.\n\n", MIN_HOUR, MAX_HOUR, APPOINTMENT_INTERVAL);
             }
         }
         else
@@ -549,84 +996,44 @@ void addAppointment(struct Appointment* appointments, int maxAppointments, struc
 
 
 // Remove an appointment record from the appointment array
-void removeAppointment(struct Appointment* appointments, int maxAppointments, struct Patient* patients, int maxPatients)
+void removeAppointment(struct ClinicData* data)
 {
-    int i = 0, isPatient = 0, isAppointment = 0, totalPatients = 0, totalAppointments = 0, patientIndex = -1, appointmentIndex = -1;
+    int patientIndex = -1, appointmentIndex = -1, patientNumber = 0;
     char remove = '\0';
-    char removeOptions[2] = { 'y','n' };
+    char removeOptions[3] = { 'y','n','\0' };
 
-    struct Appointment timeslot = { 0 };
-
-    while (patients[totalPatients].patientNumber != 0)
-        totalPatients++;
-
-    while (appointments[totalAppointments].patientNumber != 0)
-        totalAppointments++;
+    struct Date date = { 0 };
 
     printf("Patient Number: ");
-    timeslot.patientNumber = inputIntPositive();
+    patientNumber = inputIntPositive();
 
-    i = 0;
-    while (!isPatient && i < totalPatients)
-    {
-        if (patients[i].patientNumber == timeslot.patientNumber)
-        {
-            isPatient = 1;
-        }
-        else
-            i++;
-    }
+    patientIndex = findPatientIndexByPatientNum(patientNumber, data);
 
-    if (isPatient)
+    if (patientIndex != -1)
     {
-        inputDate(&timeslot.date);
+        inputDate(&date);
         printf("\n");
 
-        i = 0;
-        while (!isAppointment && i < totalAppointments)
+        appointmentIndex = findAppointmentSlot(data, patientNumber, &date);
+
+        if (appointmentIndex != -1)
         {
-            if (appointments[i].date.year == timeslot.date.year &&
-                appointments[i].date.month == timeslot.date.month &&
-                appointments[i].date.day == timeslot.date.day &&
-                appointments[i].patientNumber == timeslot.patientNumber)
-            {
-                patientIndex = findPatientIndexByPatientNum(timeslot.patientNumber, patients, totalPatients);
-                appointmentIndex = i;
-                isAppointment = 1;
-            }
-            else
-                i++;
-        }
-
-        if (isAppointment)
-        {
-            displayPatientData(&patients[patientIndex], 1);
+            displayPatientData(&data->patients[patientIndex], 1);
             printf("Are you sure you want to remove this appointment (y,n): ");
             remove = inputCharOption(removeOptions);
 
             if (remove == 'y')
             {
-                for (i = appointmentIndex; i < totalAppointments - 1; i++)
-                {
-                    appointments[i].date.year = appointments[i + 1].date.year;
-                    appointments[i].date.month = appointments[i + 1].date.month;
-                    appointments[i].date.day = appointments[i + 1].date.day;
-                    appointments[i].patientNumber = appointments[i + 1].patientNumber;
-                    appointments[i].time.hour = appointments[i + 1].time.hour;
-                    appointments[i].time.min = appointments[i + 1].time.min;
-                }
-                appointments[totalAppointments - 1].date.year = 0;
-                appointments[totalAppointments - 1].date.month = 0;
-                appointments[totalAppointments - 1].date.day = 0;
-                appointments[totalAppointments - 1].patientNumber = 0;
-                appointments[totalAppointments - 1].time.hour = 0;
-                appointments[totalAppointments - 1].time.min = 0;
-
-                printf("\nAppointment record has been removed!\n");
+                if (removeAppointmentRecord(data, appointmentIndex))
+                    printf("\nAppointment record has been removed!\n");
+                else
+                    printf("\nERROR: Appointment record could not be removed!\n");
             }
             else
                 printf("\nOperation cancelled.\n");
         }
+        else
+            printf("ERROR: Appointment record not found!\n");
     }
     else
         printf("ERROR: Patient record not found!\n");
@@ -634,23 +1041,512 @@ void removeAppointment(struct Appointment* appointments, int maxAppointments, st
     printf("\n");
 }
 
+//////////////////////////////////////
+// RECORD FUNCTIONS
+//////////////////////////////////////
+
+// Find a patient record by patient number for a search (returns its slot, -1 if not found)
+int findPatientRecord(const struct ClinicData* data, int patientNumber)
+{
+    STATS_START(started);
+    int slot = findPatientIndexByPatientNum(patientNumber, data);
+
+    STATS_STOP(STATS_FIND_PATIENT, started, 1);
+
+    return slot;
+}
+
+// Find the patients with a name word starting with 'query', or if isFuzzy a name word within a typo
+// or two of each word of 'query'; stops at maxFound (the most recently named first), returns # found
+// with the slots in slot order
+int findPatientsByName(const struct ClinicData* data, const char* query, int isFuzzy, int* slots, int maxFound)
+{
+    char normalized[NAME_INDEX_TRIGRAMS] = { 0 }, name[NAME_INDEX_TRIGRAMS] = { 0 };
+    int chains[NAME_INDEX_TRIGRAMS], trigrams[NAME_INDEX_TRIGRAMS];
+    int length = normalizeName(query, normalized, (int)sizeof(normalized));
+    int chainCount = 0, trigramCount = 0, found = 0, scanned = 0, node = 0, slot = 0, c = 0, i = 0, j = 0;
+    int isSeen = 0;
+    STATS_START(started);
+
+    chainCount = length > 0 ? chooseNameChains(&data->nameIndex, normalized, isFuzzy, chains) : 0;
+
+    // Query words too short to have enough trigrams are matched against every name
+    for (slot = 0; chainCount == -1 && found < maxFound && slot < data->patientCount; slot++)
+    {
+        normalizeName(data->patients[slot].name, name, (int)sizeof(name));
+        scanned++;
+        if (name[0] != '\0' && isNameNear(name, normalized))
+            slots[found++] = slot;
+    }
+
+    // Chains run newest first, so a common prefix stops after the first maxFound names
+    for (c = 0; c < chainCount && found < maxFound; c++)
+    {
+        for (node = nameIndexFirst(&data->nameIndex, chains[c]); node != -1 && found < maxFound;
+             node = nameIndexNext(&data->nameIndex, node))
+        {
+            slot = node / NAME_INDEX_TRIGRAMS;
+            normalizeName(data->patients[slot].name, name, (int)sizeof(name));
+            scanned++;
+
+            // A name on an earlier chain was checked there
+            isSeen = 0;
+            if (c > 0)
+            {
+                trigramCount = nameTrigrams(name, 0, trigrams);
+                for (i = 0; !isSeen && i < trigramCount; i++)
+                {
+                    for (j = 0; !isSeen && j < c; j++)
+                        isSeen = trigrams[i] == chains[j];
+                }
+            }
+
+            if (!isSeen && (isFuzzy ? isNameNear(name, normalized) : isNamePrefix(name, normalized, length)))
+                slots[found++] = slot;
+        }
+    }
+    sortSlots(slots, found);
+    STATS_STOP(STATS_FIND_NAME, started, scanned);
+
+    return found;
+}
+
+// Add a patient record, reusing a removed record's slot (returns its slot, -1 if out of memory
+// or the change could not be journaled)
+int addPatientRecord(struct ClinicData* data, const struct Patient* patient)
+{
+    STATS_START(started);
+    int slot = storeAllocatePatient(data);
+
+    if (slot != -1)
+    {
+        // The record names its slot, so the patient is placed first and taken out again if it fails
+        data->patients[slot] = *patient;
+        if (!storeIndexPatient(data, slot) || !journalLogPatient(data, JOURNAL_ADD_PATIENT, slot, patient))
+        {
+            storeRemovePatient(data, slot);
+            slot = -1;
+        }
+    }
+    STATS_STOP(STATS_ADD_PATIENT, started, 1);
+
+    return slot;
+}
+
+// Replace the name and phone of the patient in 'slot' with those of 'edited' (returns 1 on success,
+// 0 if out of memory or the change could not be journaled)
+int updatePatientRecord(struct ClinicData* data, int slot, const struct Patient* edited)
+{
+    struct Patient* patient = &data->patients[slot];
+    struct Patient original = *patient;
+    STATS_START(started);
+    int isUpdated = storeUpdatePatientPhone(data, slot, edited->phoneType, edited->phoneKey);
+    int isNamed = isUpdated && storeUpdatePatientName(data, slot, edited->name);
+
+    // A name that cannot be indexed or a change that cannot be journaled leaves the record as it was
+    if (isNamed && !journalLogPatient(data, JOURNAL_EDIT_PATIENT, slot, patient))
+    {
+        storeUpdatePatientName(data, slot, original.name);
+        isNamed = 0;
+    }
+    if (isUpdated && !isNamed)
+    {
+        storeUpdatePatientPhone(data, slot, original.phoneType, original.phoneKey);
+        isUpdated = 0;
+    }
+    STATS_STOP(STATS_EDIT_PATIENT, started, 1);
+
+    return isUpdated;
+}
+
+// Remove the patient record in 'slot' and all of the patient's appointments (returns # of appointments
+// removed, -1 if the change could not be journaled)
+int removePatientRecord(struct ClinicData* data, int slot)
+{
+    int removed = -1;
+    STATS_START(started);
+
+    // A replayed removal cascades the same way, so the appointments need no records of their own
+    if (journalLogPatient(data, JOURNAL_REMOVE_PATIENT, slot, &data->patients[slot]))
+    {
+        removed = storeRemovePatientAppointments(data, data->patients[slot].patientNumber);
+        storeRemovePatient(data, slot);
+    }
+    STATS_STOP(STATS_REMOVE_PATIENT, started, 1 + (removed > 0 ? removed : 0));
+
+    return removed;
+}
+
+// Get the timeslot a minute of the day starts (returns -1 if it does not start one)
+static int timeslotFromMinute(int minute)
+{
+    int offset = minute - MIN_HOUR * 60;
+
+    return offset >= 0 && offset <= (MAX_HOUR - MIN_HOUR) * 60 &&
+           offset % APPOINTMENT_INTERVAL == 0 ? offset / APPOINTMENT_INTERVAL : -1;
+}
+
+// Check if a time is one appointments can be booked at
+int isAppointmentTime(const struct Time* time)
+{
+    return time->min >= 0 && time->min <= 59 &&
+           timeslotFromMinute(time->hour * 60 + time->min) != -1;
+}
+
+// Get the first timeslot of an appointment's visit (returns -1 if its time, room or length can't be booked)
+int appointmentTimeslot(const struct Appointment* appoint)
+{
+    int timeslot = timeslotFromMinute((int)appoint->minute);
+
+    return timeslot != -1 && appoint->room >= 1 && appoint->room <= CLINIC_ROOMS &&
+           appoint->length >= 1 && timeslot + appoint->length <= TIMESLOTS_PER_DAY ? timeslot : -1;
+}
+
+// Get the timeslots an appointment's visit takes up (0 if it can't be booked)
+unsigned long long appointmentTimeslotMask(const struct Appointment* appoint)
+{
+    int timeslot = appointmentTimeslot(appoint);
+
+    // Shifting a 64-bit value by 64 is undefined, so a whole-word visit is spelled out
+    return timeslot == -1 ? 0 :
+           appoint->length == 64 ? ~0ull : ((1ull << appoint->length) - 1) << timeslot;
+}
+
+// Get the timeslot bitmap key of a room on a day key
+int timeslotKey(int day, int room)
+{
+    return day * CLINIC_ROOMS + room - 1;
+}
+
+// Check if an appointment's visit can be booked and its room is free for all of it
+int isTimeslotAvailable(const struct ClinicData* data, const struct Appointment* appoint)
+{
+    unsigned long long visit = appointmentTimeslotMask(appoint);
+
+    return visit != 0 &&
+           (dayBitmapGet(&data->timeslots, timeslotKey((int)appoint->day, appoint->room)) & visit) == 0;
+}
+
+// Find the rooms free for all of an appointment's visit (fills up to CLINIC_ROOMS room numbers, returns # found)
+int findFreeRooms(const struct ClinicData* data, const struct Appointment* visit, int* rooms)
+{
+    struct Appointment probe = *visit;
+    int count = 0;
+    STATS_START(started);
+
+    // One word test per room
+    for (probe.room = 1; probe.room <= CLINIC_ROOMS; probe.room++)
+    {
+        if (isTimeslotAvailable(data, &probe))
+            rooms[count++] = probe.room;
+    }
+    STATS_STOP(STATS_FREE_ROOMS, started, CLINIC_ROOMS);
+
+    return count;
+}
+
+// Get the timeslots that start between two times of day (NULL for no limit)
+static unsigned long long timeslotMask(const struct Time* earliest, const struct Time* latest)
+{
+    unsigned long long mask = 0;
+    int timeslot = 0, minute = 0;
+
+    for (timeslot = 0; timeslot < TIMESLOTS_PER_DAY; timeslot++)
+    {
+        minute = MIN_HOUR * 60 + timeslot * APPOINTMENT_INTERVAL;
+        if ((earliest == NULL || minute >= earliest->hour * 60 + earliest->min) &&
+            (latest == NULL || minute <= latest->hour * 60 + latest->min))
+            mask |= 1ull << timeslot;
+    }
+
+    return mask;
+}
+
+// Get the timeslots where a run of 'length' free timeslots starts in a room's word
+static unsigned long long freeRunStarts(unsigned long long booked, int length)
+{
+    unsigned long long free = ~booked & timeslotMask(NULL, NULL), starts = free;
+    int i = 0;
+
+    // A start survives only if each of the next length - 1 timeslots is free too
+    for (i = 1; i < length; i++)
+        starts &= free >> i;
+
+    return starts;
+}
+
+// Find the first free visits of 'length' timeslots on or after a date, optionally between two
+// times of day (NULL for no limit) and in one room (0 for any; the first free room is offered);
+// fills the day, minute, room and length of up to maxFound appointments, returns # found
+int findFreeTimeslots(const struct ClinicData* data, const struct Date* from,
+                      const struct Time* earliest, const struct Time* latest,
+                      int room, int length, struct Appointment* found, int maxFound)
+{
+    struct Appointment appoint = { 0 };
+    struct Date date = { 0 };
+    unsigned long long mask = timeslotMask(earliest, latest), starts[CLINIC_ROOMS], any = 0;
+    int day = dayKeyFromDate(from->year, from->month, from->day), count = 0;
+    int firstRoom = room == 0 ? 1 : room, lastRoom = room == 0 ? CLINIC_ROOMS : room;
+    int key = 0, lastKey = timeslotKey((1 << APPOINTMENT_DAY_BITS) - 1, lastRoom), timeslot = 0, days = 0;
+    STATS_START(started);
+
+    if (day == 0 || room < 0 || room > CLINIC_ROOMS || length < 1 || length > TIMESLOTS_PER_DAY)
+        return 0;
+
+    // Only timeslots that leave room for the whole visit can start one
+    mask &= timeslotMask(NULL, NULL) >> (length - 1);
+    appoint.length = (unsigned char)length;
+
+    // Days with every room booked solid are skipped a word at a time
+    key = timeslotKey(day, firstRoom);
+    while (count < maxFound &&
+           (key = dayBitmapNextClear(&data->timeslots, key, lastKey, room == 0 ? 1 : CLINIC_ROOMS, mask)) != -1)
+    {
+        appoint.day = (unsigned int)(key / CLINIC_ROOMS);
+        unpackAppointment(&appoint, &date, NULL);
+        days++;
+
+        // Day keys give every month 31 days, so the ones past its end are skipped
+        if (date.day <= daysInMonth(date.year, date.month))
+        {
+            any = 0;
+            for (room = firstRoom; room <= lastRoom; room++)
+            {
+                starts[room - 1] = freeRunStarts(dayBitmapGet(&data->timeslots,
+                                                              timeslotKey((int)appoint.day, room)), length) & mask;
+                any |= starts[room - 1];
+            }
+
+            // Each set bit is a free start time; it is offered in the first room free then
+            for (; any != 0 && count < maxFound; any &= any - 1, count++)
+            {
+                timeslot = lowestBit(any);
+                for (room = firstRoom; !((starts[room - 1] >> timeslot) & 1u); room++)
+                    ;
+                found[count] = appoint;
+                found[count].minute = (unsigned int)(MIN_HOUR * 60 + timeslot * APPOINTMENT_INTERVAL);
+                found[count].room = (unsigned char)room;
+            }
+        }
+        key = timeslotKey((int)appoint.day + 1, firstRoom);
+    }
+    STATS_STOP(STATS_FREE_TIMESLOTS, started, days);
+
+    return count;
+}
+
+// Add an appointment record in date/time order (returns its slot, -1 if out of memory or the
+// change could not be journaled)
+int addAppointmentRecord(struct ClinicData* data, const struct Appointment* appoint)
+{
+    STATS_START(started);
+    int slot = storeInsertAppointment(data, appoint);
+
+    // Inserting can run out of memory, so it goes first and is undone if the record cannot be written
+    if (slot != -1 && !journalLogAppointment(data, JOURNAL_ADD_APPOINTMENT, appoint))
+    {
+        storeRemoveAppointment(data, slot);
+        slot = -1;
+    }
+    STATS_STOP(STATS_ADD_APPOINTMENT, started, 1);
+
+    return slot;
+}
+
+// Find a patient's first appointment on a date (returns its slot, -1 if none)
+int findAppointmentSlot(const struct ClinicData* data, int patientNumber, const struct Date* date)
+{
+    int day = dayKeyFromDate(date->year, date->month, date->day), slot = -1, found = -1, scanned = 0;
+    STATS_START(started);
+
+    // Only the patient's own appointments are checked
+    for (slot = multiIndexFirst(&data->appointmentIndex, patientNumber); slot != -1;
+         slot = multiIndexNext(&data->appointmentIndex, slot))
+    {
+        if ((int)data->appointments[slot].day == day &&
+            (found == -1 || compareAppointments(&data->appointments[slot], &data->appointments[found]) < 0))
+            found = slot;
+        scanned++;
+    }
+    STATS_STOP(STATS_FIND_APPOINTMENT, started, scanned);
+
+    return found;
+}
+
+// Find a patient's appointments (fills up to maxFound slots in date/time order, the earliest
+// first; returns # of appointments the patient has)
+int findPatientAppointments(const struct ClinicData* data, int patientNumber, int* slots, int maxFound)
+{
+    int slot = -1, count = 0, i = 0;
+    STATS_START(started);
+
+    for (slot = multiIndexFirst(&data->appointmentIndex, patientNumber); slot != -1;
+         slot = multiIndexNext(&data->appointmentIndex, slot))
+    {
+        // Insert in order, dropping whatever falls past maxFound
+        i = count < maxFound ? count : maxFound;
+        for (; i > 0 && compareAppointments(&data->appointments[slots[i - 1]], &data->appointments[slot]) > 0; i--)
+        {
+            if (i < maxFound)
+                slots[i] = slots[i - 1];
+        }
+        if (i < maxFound)
+            slots[i] = slot;
+        count++;
+    }
+    STATS_STOP(STATS_PATIENT_APPOINTMENTS, started, count);
+
+    return count;
+}
+
+// Find the order positions of the appointments from one date to another, both included (binary
+// search for each end; returns the first position and sets *end past the last, so none if to < from)
+int findAppointmentRange(const struct ClinicData* data, const struct Date* from, const struct Date* to, int* end)
+{
+    int first = storeFirstAppointmentOnDay(data, dayKeyFromDate(from->year, from->month, from->day));
+
+    // Day keys of later dates are larger, so the slice ends where the day after 'to' would start
+    *end = storeFirstAppointmentOnDay(data, dayKeyFromDate(to->year, to->month, to->day) + 1);
+    if (*end < first)
+        *end = first;
+
+    return first;
+}
+
+// Remove the appointment record in 'slot' (returns 1 on success, 0 if the change could not be journaled)
+int removeAppointmentRecord(struct ClinicData* data, int slot)
+{
+    STATS_START(started);
+    int isRemoved = journalLogAppointment(data, JOURNAL_REMOVE_APPOINTMENT, &data->appointments[slot]);
+
+    if (isRemoved)
+        storeRemoveAppointment(data, slot);
+    STATS_STOP(STATS_REMOVE_APPOINTMENT, started, 1);
+
+    return isRemoved;
+}
+
+
+//////////////////////////////////////
+// PACKED RECORD FUNCTIONS
+//////////////////////////////////////
+
+// Get the phone type for a description (returns -1 if it is not CELL, HOME, WORK or TBD)
+int phoneTypeFromName(const char* description)
+{
+    int phoneType = PHONE_WORK;
+
+    while (phoneType >= PHONE_TBD && strcmp(description, phoneTypeName(phoneType)) != 0)
+        phoneType--;
+
+    return phoneType;
+}
+
+// Get the description of a phone type
+const char* phoneTypeName(int phoneType)
+{
+    static const char* const names[] = { "TBD", "CELL", "HOME", "WORK" };
+
+    return phoneType >= PHONE_TBD && phoneType <= PHONE_WORK ? names[phoneType] : "";
+}
+
+// Store a phone in a patient record (returns 1 on success, 0 if it is not valid)
+int packPhone(struct Patient* patient, const struct Phone* phone)
+{
+    int phoneType = phoneTypeFromName(phone->description);
+    long long phoneKey = phoneKeyFromString(phone->number);
+
+    if (phoneType == -1 || (phoneKey == 0 && phone->number[0] != '\0'))
+        return 0;
+
+    patient->phoneType = (unsigned char)phoneType;
+    patient->phoneKey = phoneKey;
+
+    return 1;
+}
+
+// Get the text form of a patient's phone
+void unpackPhone(const struct Patient* patient, struct Phone* phone)
+{
+    strcpy(phone->description, phoneTypeName(patient->phoneType));
+    phoneStringFromKey(patient->phoneKey, phone->number);
+}
+
+// Build a one-timeslot appointment in room 1 from its date and time (returns 1 on success, 0 if they can't be packed)
+int packAppointment(struct Appointment* appoint, int patientNumber,
+                    const struct Date* date, const struct Time* time)
+{
+    int day = dayKeyFromDate(date->year, date->month, date->day);
+
+    if (day == 0 || day >= (1 << APPOINTMENT_DAY_BITS) ||
+        time->hour < 0 || time->hour > 23 || time->min < 0 || time->min > 59)
+        return 0;
+
+    appoint->patientNumber = patientNumber;
+    appoint->day = (unsigned int)day;
+    appoint->minute = (unsigned int)(time->hour * 60 + time->min);
+    appoint->room = 1;
+    appoint->length = 1;
+
+    return 1;
+}
+
+// Get the date and time of an appointment (either may be NULL)
+void unpackAppointment(const struct Appointment* appoint, struct Date* date, struct Time* time)
+{
+    int day = (int)appoint->day - 1;
+
+    // Inverse of dayKeyFromDate: every month spans 31 keys
+    if (date != NULL)
+    {
+        date->day = day % 31 + 1;
+        date->month = day / 31 % 12 + 1;
+        date->year = day / 31 / 12;
+    }
+    if (time != NULL)
+    {
+        time->hour = (int)appoint->minute / 60;
+        time->min = (int)appoint->minute % 60;
+    }
+}
+
+// Set the room and length in minutes of an appointment's visit (returns 1 on success, 0 if they can't be booked)
+int packVisit(struct Appointment* appoint, int room, int minutes)
+{
+    if (room < 1 || room > CLINIC_ROOMS || minutes < APPOINTMENT_INTERVAL ||
+        minutes % APPOINTMENT_INTERVAL != 0 || minutes / APPOINTMENT_INTERVAL > TIMESLOTS_PER_DAY)
+        return 0;
+
+    appoint->room = (unsigned char)room;
+    appoint->length = (unsigned char)(minutes / APPOINTMENT_INTERVAL);
+
+    return 1;
+}
+
+// Get the length of an appointment's visit in minutes
+int visitMinutes(const struct Appointment* appoint)
+{
+    return appoint->length * APPOINTMENT_INTERVAL;
+}
+
+
 //////////////////////////////////////
 // UTILITY FUNCTIONS
 //////////////////////////////////////
 
 // Search and display patient record by patient number (form)
-void searchPatientByPatientNumber(const struct Patient patient[], int max)
+void searchPatientByPatientNumber(const struct ClinicData* data)
 {
     int number = 0, index = 0;
 
     printf("Search by patient number: ");
 
     number = inputIntPositive();
-    index = findPatientIndexByPatientNum(number, patient, max);
+    index = findPatientRecord(data, number);
     printf("\n");
 
     if (index != -1)
-        displayPatientData(&patient[index], FMT_FORM);
+        displayPatientData(&data->patients[index], FMT_FORM);
     else
         printf("*** No records found ***\n");
 
@@ -659,70 +1555,45 @@ void searchPatientByPatientNumber(const struct Patient patient[], int max)
 }
 
 // Search and display patient records by phone number (tabular)
-void searchPatientByPhoneNumber(const struct Patient patient[], int max)
+void searchPatientByPhoneNumber(const struct ClinicData* data)
 {
     char phoneNumber[PHONE_LEN + 1] = { 0 };
-    int i = 0, found = 0;
 
     printf("Search by phone number: ");
     inputCString(phoneNumber, PHONE_LEN, PHONE_LEN);
     printf("\n");
 
-    displayPatientTableHeader();
-    for (i = 0; i < max; i++)
-    {
-        if (!strcmp(patient[i].phone.number, phoneNumber))
-        {
-            found += 1;
-            displayPatientData(&patient[i], FMT_TABLE);
-        }
-    }
+    displayPatientsByPhone(data, phoneKeyFromString(phoneNumber));
+    suspend();
+}
 
-    if (!found)
-    {
-        printf("\n");
-        printf("*** No records found ***\n");
-    }
+// Search and display patient records by name (tabular)
+void searchPatientByName(const struct ClinicData* data)
+{
+    char name[NAME_LEN + 1] = { 0 };
 
+    printf("Search by name: ");
+    inputCString(name, 1, NAME_LEN);
     printf("\n");
+
+    displayPatientsByName(data, name);
     suspend();
 }
 
-// Get the next highest patient number
-int nextPatientNumber(const struct Patient patient[], int max)
+// Get the next patient number (numbers are never reused, even after a removal)
+int nextPatientNumber(const struct ClinicData* data)
 {
-    int highestNumber = 0;
-    int i = 0;
-
-    highestNumber = patient[0].patientNumber;
-    for (i = 1; i < max; i++)
-    {
-        if (highestNumber < patient[i].patientNumber)
-            highestNumber = patient[i].patientNumber;
-    }
-    highestNumber += 1;
-
-    return (highestNumber);
+    return data->lastPatientNumber + 1;
 }
 
 // Find the patient array index by patient number (returns -1 if not found)
 int findPatientIndexByPatientNum(int patientNumber,
-    const struct Patient patient[], int max)
+    const struct ClinicData* data)
 {
-    int i = 0, index = -1, found = 0;
-
-    while (!found && i < max)
-    {
-        if (patient[i].patientNumber == patientNumber)
-        {
-            index = i;
-            found = 1;
-        }
-        else
-            i++;
-    }
+    int slot = patientIndexFind(&data->patientIndex, patientNumber);
 
-    return index;
+    // The index is mapped from the snapshot unchecked, so a slot past the store reads as not found
+    return slot >= 0 && slot < data->patientCount ? slot : -1;
 }
 
 //////////////////////////////////////
@@ -732,6 +1603,8 @@ int findPatientIndexByPatientNum(int patientNumber,
 // Get user input for a new patient record
 void inputPatient(struct Patient* patient)
 {
+    struct Phone phone = { 0 };
+
     printf("Patient Data Input\n");
     printf("------------------\n");
     printf("Number: %05d\n", patient->patientNumber);
@@ -739,7 +1612,8 @@ void inputPatient(struct Patient* patient)
     inputCString(patient->name, 1, NAME_LEN);
     printf("\n");
 
-    inputPhoneData(&patient->phone);
+    inputPhoneData(&phone);
+    packPhone(patient, &phone);
 }
 
 // Get user input for phone contact information
@@ -794,58 +1668,89 @@ void inputPhoneData(struct Phone* phone)
 // FILE FUNCTIONS
 //////////////////////////////////////
 
-// Import patient data from file into a Patient array (returns # of records read)
-int importPatients(const char* datafile, struct Patient patients[], int max)
+// Import patient data from file into the patient store (returns # of records read)
+int importPatients(const char* datafile, struct ClinicData* data)
 {
-    int i = 0, isEOF = 0;
-    FILE* patientData = NULL;
-    patientData = fopen(datafile, "r");
-
-    if (patientData != NULL)
+    int i = 0, c = 0, r = 0, chunkCount = 0, total = 0, firstLine = 0, isFull = 0;
+    struct LoadedFile file = { 0 };
+    struct LoadChunk* chunks = NULL;
+    const struct Patient* records = NULL;
+    struct Patient* patient = NULL;
+    STATS_START(started);
+
+    if (loadFile(datafile, &file))
     {
-        while (!isEOF && i < max)
+        // Lines are parsed in parallel; records are merged here in file order
+        chunkCount = parseFileChunks(&file, LOAD_PATIENTS, &chunks);
+        for (c = 0; c < chunkCount; c++)
+            total += chunks[c].recordCount;
+        storeReservePatients(data, data->patientCount + total);
+
+        for (c = 0; !isFull && c < chunkCount; c++)
         {
-            fscanf(patientData, "%d|%[^|]|%[^|]|%[^\n]",
-                &patients[i].patientNumber,
-                patients[i].name,
-                patients[i].phone.description,
-                patients[i].phone.number);
-
-            isEOF = feof(patientData);
-            if (!isEOF)
-                i++;
+            firstLine += reportChunkErrors(datafile, firstLine, &chunks[c]);
+            records = chunks[c].records;
+
+            for (r = 0; !isFull && r < chunks[c].recordCount; r++)
+            {
+                patient = storeAppendPatient(data);
+                if (patient != NULL)
+                {
+                    *patient = records[r];
+                    i++;
+
+                    // The first record with a given number wins, as with a linear search
+                    if (findPatientIndexByPatientNum(records[r].patientNumber, data) == -1 &&
+                        !storeIndexPatient(data, data->patientCount - 1))
+                        isFull = 1;
+                }
+                else
+                    isFull = 1;
+            }
+            isFull = isFull || chunks[c].isFull;
         }
-        fclose(patientData);
+        freeFileChunks(chunks, chunkCount);
+        freeLoadedFile(&file);
     }
+    STATS_STOP(STATS_IMPORT_PATIENTS, started, i);
 
     return i;
 }
 
-// Import appointment data from file into an Appointment array (returns # of records read)
-int importAppointments(const char* datafile, struct Appointment appoints[], int max)
+// Import appointment data from file into the appointment store (returns # of records read)
+int importAppointments(const char* datafile, struct ClinicData* data)
 {
-    int i = 0, isEOF = 0;
-    FILE* appointmentData = NULL;
-    appointmentData = fopen(datafile, "r");
+    int i = 0, c = 0, chunkCount = 0, total = 0, firstLine = 0, isFull = 0;
+    struct LoadedFile file = { 0 };
+    struct LoadChunk* chunks = NULL;
+    STATS_START(started);
 
-    if (appointmentData != NULL)
+    if (loadFile(datafile, &file))
     {
-        while (!isEOF && i < max)
+        // Lines are parsed in parallel; records are merged here in file order
+        chunkCount = parseFileChunks(&file, LOAD_APPOINTMENTS, &chunks);
+        for (c = 0; c < chunkCount; c++)
+            total += chunks[c].recordCount;
+        storeReserveAppointments(data, data->appointmentSlotCount + total);
+
+        for (c = 0; !isFull && c < chunkCount; c++)
         {
-            fscanf(appointmentData, "%d,%d,%d,%d,%d,%d",
-                &appoints[i].patientNumber,
-                &appoints[i].date.year,
-                &appoints[i].date.month,
-                &appoints[i].date.day,
-                &appoints[i].time.hour,
-                &appoints[i].time.min);
-
-            isEOF = feof(appointmentData);
-            if (!isEOF)
-                i++;
+            firstLine += reportChunkErrors(datafile, firstLine, &chunks[c]);
+
+            if (storeAppendAppointments(data, chunks[c].records, chunks[c].recordCount))
+                i += chunks[c].recordCount;
+            else
+                isFull = 1;
+            isFull = isFull || chunks[c].isFull;
         }
-        fclose(appointmentData);
+        freeFileChunks(chunks, chunkCount);
+        freeLoadedFile(&file);
+
+        // One bulk sort instead of an ordered insert per record
+        if (!storeSortAppointments(data))
+            fprintf(stderr, "ERROR: %s: not enough memory to index the booked timeslots\n", datafile);
     }
+    STATS_STOP(STATS_IMPORT_APPOINTMENTS, started, i);
 
     return i;
 }
@@ -855,140 +1760,91 @@ int importAppointments(const char* datafile, struct Appointment appoints[], int
 //////////////////////////////////////
 
 // Sort appointment info
-void  sortAppointments(struct Appointment* appointments, int totalAppointments)
+void sortAppointments(struct Appointment* appointments, int totalAppointments)
 {
-    int i = 0, j = 0, minAppointmentIndex = 0;
-    struct Appointment tempAppointment = { 0 };
-
-    for (i = 0; i < totalAppointments; i++)
-    {
-        minAppointmentIndex = i;
+    int i = 0;
+    struct SortItem* items = NULL;
+    struct SortItem* buffer = NULL;
+    struct Appointment* sorted = NULL;
 
-        for (j = i + 1; j < totalAppointments; j++)
-        {
-            if (appointments[j].date.year < appointments[minAppointmentIndex].date.year)
+    if (totalAppointments < 2)
+        return;
 
-                minAppointmentIndex = j;
+    items = malloc((size_t)totalAppointments * sizeof(struct SortItem));
+    buffer = malloc((size_t)totalAppointments * sizeof(struct SortItem));
+    sorted = malloc((size_t)totalAppointments * sizeof(struct Appointment));
 
-            else if (appointments[j].date.year == appointments[minAppointmentIndex].date.year)
-            {
-                if (appointments[j].date.month < appointments[minAppointmentIndex].date.month)
-                {
-                    minAppointmentIndex = j;
-                }
-                else if (appointments[j].date.month == appointments[minAppointmentIndex].date.month)
-                {
-                    if (appointments[j].date.day < appointments[minAppointmentIndex].date.day)
-                    {
-                        minAppointmentIndex = j;
-                    }
-                    else if (appointments[j].date.day == appointments[minAppointmentIndex].date.day)
-                    {
-                        if (appointments[j].time.hour < appointments[minAppointmentIndex].time.hour)
-                        {
-                            minAppointmentIndex = j;
-                        }
-                        else if (appointments[j].time.hour == appointments[minAppointmentIndex].time.hour)
-                        {
-                            if (appointments[j].time.min < appointments[minAppointmentIndex].time.min)
-                            {
-                                minAppointmentIndex = j;
-                            }
-                        }
-                    }
-                }
-            }
-        }
-
-        if (minAppointmentIndex != i)
+    if (items == NULL || buffer == NULL || sorted == NULL)
+    {
+        // Not enough memory for the fast paths: sort in place instead
+        insertionSortAppointments(appointments, totalAppointments);
+    }
+    else
+    {
+        for (i = 0; i < totalAppointments; i++)
         {
-            tempAppointment.patientNumber = appointments[i].patientNumber;
-            tempAppointment.date.year = appointments[i].date.year;
-            tempAppointment.date.month = appointments[i].date.month;
-            tempAppointment.date.day = appointments[i].date.day;
-            tempAppointment.time.hour = appointments[i].time.hour;
-            tempAppointment.time.min = appointments[i].time.min;
-
-            appointments[i].patientNumber = appointments[minAppointmentIndex].patientNumber;
-            appointments[i].date.year = appointments[minAppointmentIndex].date.year;
-            appointments[i].date.month = appointments[minAppointmentIndex].date.month;
-            appointments[i].date.day = appointments[minAppointmentIndex].date.day;
-            appointments[i].time.hour = appointments[minAppointmentIndex].time.hour;
-            appointments[i].time.min = appointments[minAppointmentIndex].time.min;
-
-            appointments[minAppointmentIndex].patientNumber = tempAppointment.patientNumber;
-            appointments[minAppointmentIndex].date.year = tempAppointment.date.year;
-            appointments[minAppointmentIndex].date.month = tempAppointment.date.month;
-            appointments[minAppointmentIndex].date.day = tempAppointment.date.day;
-            appointments[minAppointmentIndex].time.hour = tempAppointment.time.hour;
-            appointments[minAppointmentIndex].time.min = tempAppointment.time.min;
+            items[i].key = appointmentSortKey(&appointments[i]);
+            items[i].index = i;
         }
-    }
-}
-
-// Get user input for a date
-void inputDate(struct Date* date)
-{
-    int isLeapYear = 0, maxDay = 0;
-
-    printf("Year        : ");
-    date->year = inputIntPositive();
 
-    isLeapYear = (date->year % 4) == 0;
+        radixSortItems(items, buffer, totalAppointments);
 
-    printf("Month (1-12): ");
-    date->month = inputIntRange(1, 12);
+        for (i = 0; i < totalAppointments; i++)
+            sorted[i] = appointments[items[i].index];
+        memcpy(appointments, sorted, (size_t)totalAppointments * sizeof(struct Appointment));
+    }
 
-    switch (date->month)
-    {
-    case 1:
-        maxDay = 31;
-        break;
+    free(items);
+    free(buffer);
+    free(sorted);
+}
 
-    case 2:
-        maxDay = 28 + isLeapYear;
-        break;
+// Pack an appointment's day, minute and patient number into a 64-bit sort key
+unsigned long long appointmentSortKey(const struct Appointment* appoint)
+{
+    unsigned long long when = ((unsigned long long)appoint->day << APPOINTMENT_MINUTE_BITS) |
+                              appoint->minute;
 
-    case 3:
-        maxDay = 31;
-        break;
+    // | day key: 21 bits | minute of day: 11 bits | patient number, sign bit flipped: 32 bits |
+    return (when << 32) | ((unsigned int)appoint->patientNumber ^ 0x80000000u);
+}
 
-    case 4:
-        maxDay = 30;
-        break;
+// Compare two appointments by date, time, then patient number (<0, 0, >0)
+int compareAppointments(const struct Appointment* a, const struct Appointment* b)
+{
+    int result = 0;
 
-    case 5:
-        maxDay = 31;
-        break;
+    if (a->day != b->day)
+        result = a->day < b->day ? -1 : 1;
+    else if (a->minute != b->minute)
+        result = a->minute < b->minute ? -1 : 1;
+    else if (a->patientNumber != b->patientNumber)
+        result = a->patientNumber < b->patientNumber ? -1 : 1;
 
-    case 6:
-        maxDay = 30;
-        break;
+    return result;
+}
 
-    case 7:
-        maxDay = 31;
-        break;
+// Get the number of days in a month
+int daysInMonth(int year, int month)
+{
+    static const int monthDays[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    int isLeapYear = (year % 4) == 0;
 
-    case 8:
-        maxDay = 31;
-        break;
+    return month == 2 ? monthDays[1] + isLeapYear : monthDays[month - 1];
+}
 
-    case 9:
-        maxDay = 30;
-        break;
+// Get user input for a date
+void inputDate(struct Date* date)
+{
+    int maxDay = 0;
 
-    case 10:
-        maxDay = 31;
-        break;
+    printf("Year        : ");
+    date->year = inputIntPositive();
 
-    case 11:
-        maxDay = 30;
-        break;
+    printf("Month (1-12): ");
+    date->month = inputIntRange(1, 12);
 
-    case 12:
-        maxDay = 31;
-        break;
-    }
+    maxDay = daysInMonth(date->year, date->month);
 
     printf("Day (1-%d)  : ", maxDay);
     date->day = inputIntRange(1, maxDay);
@@ -1011,11 +1867,10 @@ void inputPhoneNumber(char* phoneString)
         if (length == PHONE_LEN)
         {
             i = 0;
-            while (i < length)
+            correct = 1;
+            while (correct && i < length)
             {
-                if (inputString[i] >= minAscii || inputString[i] <= maxAscii)
-                    correct = 1;
-                else
+                if (inputString[i] < minAscii || inputString[i] > maxAscii)
                     correct = 0;
                 i++;
             }
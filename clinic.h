@@ -1,6 +1,10 @@
 #ifndef CLINIC_H
 #define CLINIC_H
 
+#include "index.h"
+#include "journal.h"
+#include "snapshot.h"
+
 // Formatting options
 #define FMT_FORM 1
 #define FMT_TABLE 2
@@ -10,30 +14,63 @@
 #define PHONE_DESC_LEN 4
 #define PHONE_LEN 10
 
+#if NAME_LEN + 1 > NAME_INDEX_TRIGRAMS
+#error "A name's trigrams must fit the nodes a NameIndex keeps per slot"
+#endif
 
 // Other macros
-#define MAX_APPOINTMENTS 50
 #define MIN_HOUR 10
 #define MAX_HOUR 14
 #define APPOINTMENT_INTERVAL 30
 
+// Bookable timeslots in a day (MIN_HOUR:00 to MAX_HOUR:00, one per APPOINTMENT_INTERVAL)
+#define TIMESLOTS_PER_DAY ((MAX_HOUR - MIN_HOUR) * 60 / APPOINTMENT_INTERVAL + 1)
+
+#if TIMESLOTS_PER_DAY > 64
+#error "A day's timeslots must fit the 64-bit words of a DayBitmap"
+#endif
+
+// Rooms appointments are booked in (numbered from 1, each with its own timeslots)
+#define CLINIC_ROOMS 3
+
+// Free timeslots offered when a requested timeslot is taken
+#define FREE_TIMESLOT_OFFERS 5
+
+// Most patients a name search lists
+#define NAME_SEARCH_LIMIT 100
+
+// Most appointments a patient's appointment list shows (the earliest first)
+#define PATIENT_APPOINTMENT_LIMIT 100
+
+// Phone types (stored in a patient record instead of the description text)
+#define PHONE_TBD 0
+#define PHONE_CELL 1
+#define PHONE_HOME 2
+#define PHONE_WORK 3
+
+// Packed appointment field widths (see struct Appointment)
+#define APPOINTMENT_DAY_BITS 21
+#define APPOINTMENT_MINUTE_BITS 11
+
 //////////////////////////////////////
 // Structures
 //////////////////////////////////////
 
-// Data type: Phone
+// Data type: Phone (text form, used for input, data files and display)
 struct Phone
 {
     char description[PHONE_DESC_LEN + 1];
     char number[PHONE_LEN + 1];
 };
 
-// Data type: Patient 
+// Data type: Patient (phoneKey is the phone number as packed by
+// phoneKeyFromString, 0 if none; phoneType is one of the PHONE_ types)
 struct Patient
 {
+    long long phoneKey;
     int patientNumber;
     char name[NAME_LEN + 1];
-    struct Phone phone;
+    unsigned char phoneType;
 };
 
 // Data type: Time
@@ -51,21 +88,64 @@ struct Date
     int year;
 };
 
-// Data type: Appointment
+// Data type: Appointment (packed into 12 bytes: day is the day key from
+// dayKeyFromDate, minute the minute of the day, room numbered from 1 and
+// length the visit's number of timeslots; see packAppointment and packVisit)
 struct Appointment
 {
     int patientNumber;
-    struct Date date;
-    struct Time time;
+    unsigned int day : APPOINTMENT_DAY_BITS;
+    unsigned int minute : APPOINTMENT_MINUTE_BITS;
+    unsigned char room;
+    unsigned char length;
+};
+
+// Data type: Appointment Handle (slab slot and the generation it was issued for)
+struct AppointmentHandle
+{
+    int slot;
+    unsigned int generation;
 };
 
-// Data type: Clinic Data
+// Data type: Clinic Data (freeSlots lists vacated patient slots, most recently
+// vacated last; appointments is a slab whose records never move: a slot's
+// generation is odd while it holds a live appointment, appointmentOrder lists
+// slots in date/time order (removed ones until the next compaction) and
+// freeAppointmentSlot chains reusable slots through their patient numbers;
+// timeslots has bit n of a room's word for a day (see timeslotKey) set while
+// a visit in that room takes up timeslot n that day; appointmentIndex chains
+// the slots of each patient's live appointments under their patient number)
 struct ClinicData
 {
     struct Patient* patients;
-    int maxPatient;
+    int patientCount;
+    int patientCapacity;
     struct Appointment* appointments;
-    int maxAppointments;
+    unsigned int* appointmentGenerations;
+    int appointmentSlotCount;
+    int appointmentCapacity;
+    int* appointmentOrder;
+    int appointmentOrderCount;
+    int appointmentOrderCapacity;
+    int appointmentCount;
+    int freeAppointmentSlot;
+    struct PatientIndex patientIndex;
+    struct MultiIndex phoneIndex;
+    struct MultiIndex appointmentIndex;
+    struct NameIndex nameIndex;
+    struct DayBitmap timeslots;
+    struct MappedFile snapshot;
+    int* freeSlots;
+    int freeSlotCount;
+    int freeSlotCapacity;
+    int lastPatientNumber;
+    int patientsBorrowed;
+    int appointmentsBorrowed;
+    int generationsBorrowed;
+    int appointmentOrderBorrowed;
+    int freeSlotsBorrowed;
+    struct Journal* journal;
+    unsigned long long lastLsn;
 };
 
 //////////////////////////////////////
@@ -81,11 +161,32 @@ void displayPatientData(const struct Patient* patient, int fmt);
 // Display's appointment schedule headers (date-specific or all records)
 void displayScheduleTableHeader(const struct Date* date, int isAllRecords);
 
+// Display's the appointment schedule header for the dates from 'from' to 'to'
+void displayRangeTableHeader(const struct Date* from, const struct Date* to);
+
 // Display a single appointment record with patient info. in tabular format
 void displayScheduleData(const struct Patient* patient,
                          const struct Appointment* appoint,
                          int includeDateField);
 
+// Display the first free visits of 'length' timeslots on or after a date (in one room, or any if 0)
+void displayFreeTimeslots(const struct ClinicData* data, const struct Date* from, int room, int length);
+
+// Display the patients with a phone number (tabular)
+void displayPatientsByPhone(const struct ClinicData* data, long long phoneKey);
+
+// Display the patients with a name word starting with a search, or failing that names close to it (tabular)
+void displayPatientsByName(const struct ClinicData* data, const char* query);
+
+// Display the appointment schedule for a date
+void displayAppointmentSchedule(const struct ClinicData* data, const struct Date* date);
+
+// Display the appointments from one date to another (both included)
+void displayAppointmentRange(const struct ClinicData* data, const struct Date* from, const struct Date* to);
+
+// Display a patient's appointments in date/time order (tabular)
+void displayPatientAppointments(const struct ClinicData* data, const struct Patient* patient);
+
 
 //////////////////////////////////////
 // MENU & ITEM SELECTION FUNCTIONS
@@ -95,28 +196,28 @@ void displayScheduleData(const struct Patient* patient,
 void menuMain(struct ClinicData* data);
 
 // Menu: Patient Management
-void menuPatient(struct Patient patient[], int max);
+void menuPatient(struct ClinicData* data);
 
 // Menu: Patient edit
-void menuPatientEdit(struct Patient* patient);
+void menuPatientEdit(struct ClinicData* data, int index);
 
 // Menu: Appointment Management
 void menuAppointment(struct ClinicData* data);
 
 // Display's all patient data in the FMT_FORM | FMT_TABLE format
-void displayAllPatients(const struct Patient patient[], int max, int fmt);
+void displayAllPatients(const struct Patient patient[], int count, int fmt);
 
 // Search for a patient record based on patient number or phone number
-void searchPatientData(const struct Patient patient[], int max);
+void searchPatientData(const struct ClinicData* data);
 
 // Add a new patient record to the patient array
-void addPatient(struct Patient patient[], int max);
+void addPatient(struct ClinicData* data);
 
 // Edit a patient record from the patient array
-void editPatient(struct Patient patient[], int max);
+void editPatient(struct ClinicData* data);
 
 // Remove a patient record from the patient array
-void removePatient(struct Patient patient[], int max);
+void removePatient(struct ClinicData* data);
 
 
 // View ALL scheduled appointments
@@ -125,11 +226,115 @@ void viewAllAppointments(struct ClinicData* data);
 // View appointment schedule for the user input date
 void viewAppointmentSchedule(struct ClinicData* data);
 
+// View the appointments of a user input patient
+void viewPatientAppointments(struct ClinicData* data);
+
+// View the appointments between two user input dates
+void viewAppointmentRange(struct ClinicData* data);
+
 // Add an appointment record to the appointment array
-void addAppointment(struct Appointment* appointments, int maxAppointments, struct Patient* patients, int maxPatients);
+void addAppointment(struct ClinicData* data);
 
 // Remove an appointment record from the appointment array
-void removeAppointment(struct Appointment* appointments, int maxAppointments, struct Patient* patients, int maxPatients);
+void removeAppointment(struct ClinicData* data);
+
+
+//////////////////////////////////////
+// RECORD FUNCTIONS
+//////////////////////////////////////
+
+// Find a patient record by patient number for a search (returns its slot, -1 if not found)
+int findPatientRecord(const struct ClinicData* data, int patientNumber);
+
+// Find the patients with a name word starting with 'query', or if isFuzzy a name word within a typo
+// or two of each word of 'query'; stops at maxFound (the most recently named first), returns # found
+// with the slots in slot order
+int findPatientsByName(const struct ClinicData* data, const char* query, int isFuzzy, int* slots, int maxFound);
+
+// Add a patient record, reusing a removed record's slot (returns its slot, -1 if out of memory
+// or the change could not be journaled)
+int addPatientRecord(struct ClinicData* data, const struct Patient* patient);
+
+// Replace the name and phone of the patient in 'slot' with those of 'edited' (returns 1 on success,
+// 0 if out of memory or the change could not be journaled)
+int updatePatientRecord(struct ClinicData* data, int slot, const struct Patient* edited);
+
+// Remove the patient record in 'slot' and all of the patient's appointments (returns # of appointments
+// removed, -1 if the change could not be journaled)
+int removePatientRecord(struct ClinicData* data, int slot);
+
+// Check if a time is one appointments can be booked at
+int isAppointmentTime(const struct Time* time);
+
+// Get the first timeslot of an appointment's visit (returns -1 if its time, room or length can't be booked)
+int appointmentTimeslot(const struct Appointment* appoint);
+
+// Get the timeslots an appointment's visit takes up (0 if it can't be booked)
+unsigned long long appointmentTimeslotMask(const struct Appointment* appoint);
+
+// Get the timeslot bitmap key of a room on a day key
+int timeslotKey(int day, int room);
+
+// Check if an appointment's visit can be booked and its room is free for all of it
+int isTimeslotAvailable(const struct ClinicData* data, const struct Appointment* appoint);
+
+// Find the rooms free for all of an appointment's visit (fills up to CLINIC_ROOMS room numbers, returns # found)
+int findFreeRooms(const struct ClinicData* data, const struct Appointment* visit, int* rooms);
+
+// Find the first free visits of 'length' timeslots on or after a date, optionally between two
+// times of day (NULL for no limit) and in one room (0 for any; the first free room is offered);
+// fills the day, minute, room and length of up to maxFound appointments, returns # found
+int findFreeTimeslots(const struct ClinicData* data, const struct Date* from,
+                      const struct Time* earliest, const struct Time* latest,
+                      int room, int length, struct Appointment* found, int maxFound);
+
+// Add an appointment record in date/time order (returns its slot, -1 if out of memory or the
+// change could not be journaled)
+int addAppointmentRecord(struct ClinicData* data, const struct Appointment* appoint);
+
+// Find a patient's first appointment on a date (returns its slot, -1 if none)
+int findAppointmentSlot(const struct ClinicData* data, int patientNumber, const struct Date* date);
+
+// Find a patient's appointments (fills up to maxFound slots in date/time order, the earliest
+// first; returns # of appointments the patient has)
+int findPatientAppointments(const struct ClinicData* data, int patientNumber, int* slots, int maxFound);
+
+// Find the order positions of the appointments from one date to another, both included (binary
+// search for each end; returns the first position and sets *end past the last, so none if to < from)
+int findAppointmentRange(const struct ClinicData* data, const struct Date* from, const struct Date* to, int* end);
+
+// Remove the appointment record in 'slot' (returns 1 on success, 0 if the change could not be journaled)
+int removeAppointmentRecord(struct ClinicData* data, int slot);
+
+
+//////////////////////////////////////
+// PACKED RECORD FUNCTIONS
+//////////////////////////////////////
+
+// Get the phone type for a description (returns -1 if it is not CELL, HOME, WORK or TBD)
+int phoneTypeFromName(const char* description);
+
+// Get the description of a phone type
+const char* phoneTypeName(int phoneType);
+
+// Store a phone in a patient record (returns 1 on success, 0 if it is not valid)
+int packPhone(struct Patient* patient, const struct Phone* phone);
+
+// Get the text form of a patient's phone
+void unpackPhone(const struct Patient* patient, struct Phone* phone);
+
+// Build a one-timeslot appointment in room 1 from its date and time (returns 1 on success, 0 if they can't be packed)
+int packAppointment(struct Appointment* appoint, int patientNumber,
+                    const struct Date* date, const struct Time* time);
+
+// Get the date and time of an appointment (either may be NULL)
+void unpackAppointment(const struct Appointment* appoint, struct Date* date, struct Time* time);
+
+// Set the room and length in minutes of an appointment's visit (returns 1 on success, 0 if they can't be booked)
+int packVisit(struct Appointment* appoint, int room, int minutes);
+
+// Get the length of an appointment's visit in minutes
+int visitMinutes(const struct Appointment* appoint);
 
 
 //////////////////////////////////////
@@ -137,17 +342,20 @@ void removeAppointment(struct Appointment* appointments, int maxAppointments, st
 //////////////////////////////////////
 
 // Search and display patient record by patient number (form)
-void searchPatientByPatientNumber(const struct Patient patient[], int max);
+void searchPatientByPatientNumber(const struct ClinicData* data);
 
 // Search and display patient records by phone number (tabular)
-void searchPatientByPhoneNumber(const struct Patient patient[], int max);
+void searchPatientByPhoneNumber(const struct ClinicData* data);
+
+// Search and display patient records by name (tabular)
+void searchPatientByName(const struct ClinicData* data);
 
-// Get the next highest patient number
-int nextPatientNumber(const struct Patient patient[], int max);
+// Get the next patient number (numbers are never reused, even after a removal)
+int nextPatientNumber(const struct ClinicData* data);
 
 // Find the patient array index by patient number (returns -1 if not found)
 int findPatientIndexByPatientNum(int patientNumber,
-                                 const struct Patient patient[], int max);
+                                 const struct ClinicData* data);
 
 
 //////////////////////////////////////
@@ -165,11 +373,11 @@ void inputPhoneData(struct Phone* phone);
 // FILE FUNCTIONS
 //////////////////////////////////////
 
-// Import patient data from file into a Patient array (returns # of records read)
-int importPatients(const char* datafile, struct Patient patients[], int max);
+// Import patient data from file into the patient store (returns # of records read)
+int importPatients(const char* datafile, struct ClinicData* data);
 
-// Import appointment data from file into an Appointment array (returns # of records read)
-int importAppointments(const char* datafile, struct Appointment appoints[], int max);
+// Import appointment data from file into the appointment store (returns # of records read)
+int importAppointments(const char* datafile, struct ClinicData* data);
 
 //////////////////////////////////////
 // UTILITY FUNCTIONS
@@ -178,6 +386,15 @@ int importAppointments(const char* datafile, struct Appointment appoints[], int
 // Sort appointment info
 void sortAppointments(struct Appointment* appointments, int totalAppointments);
 
+// Pack an appointment's day, minute and patient number into a 64-bit sort key
+unsigned long long appointmentSortKey(const struct Appointment* appoint);
+
+// Compare two appointments by date, time, then patient number (<0, 0, >0)
+int compareAppointments(const struct Appointment* a, const struct Appointment* b);
+
+// Get the number of days in a month
+int daysInMonth(int year, int month);
+
 // Get user input for a date and validate
 void inputDate(struct Date* date);
 
@@ -119,12 +119,15 @@ char inputCharOption(const char stringArray[])
 void inputCString(char* cString, int minChar, int maxChar)
 {
     int cStringLength = 0;
+    char line[INPUT_LINE_LEN + 1] = { 0 };
 
+    // Read into a line buffer so over-long input never spills past the caller's string
     while (cStringLength < minChar || cStringLength > maxChar)
     {
-        scanf("%[^\n]", cString);
+        line[0] = '\0';
+        scanf(INPUT_LINE_FORMAT, line);
 
-        cStringLength = strlen(cString);
+        cStringLength = strlen(line);
         clearInputBuffer();
 
         if (minChar == maxChar && cStringLength != maxChar)
@@ -142,6 +145,8 @@ void inputCString(char* cString, int minChar, int maxChar)
             }
         }
     }
+
+    strcpy(cString, line);
 }
 
 // Display an array of 10-character digits as a formatted phone number
@@ -1,6 +1,10 @@
 #ifndef CORE_H
 #define CORE_H
 
+// Longest line inputCString reads before checking its length (longer input is rejected)
+#define INPUT_LINE_LEN 255
+#define INPUT_LINE_FORMAT "%255[^\n]"
+
 //////////////////////////////////////
 // USER INTERFACE FUNCTIONS
 //////////////////////////////////////
@@ -0,0 +1,963 @@
+/*
+Index module
+- Patient index functions: open-addressing hash from patient number
+  to patient store slot.
+- Multi index functions: open-addressing multimap from a key (packed
+  phone number, patient number) to the doubly linked chain of store
+  slots sharing it, so adding or removing a slot costs a few links
+  however long the chain is.
+- Name index functions: trigram postings for name searches. Each name
+  has a fixed block of nodes, one per distinct trigram, and every node
+  sits on its trigram's doubly linked chain, so adding or removing a
+  name costs a few links however long the chains are.
+- Day bitmap functions: a word of bits per calendar day key (or per
+  day and room), kept in a window that grows to cover the keys in use.
+- Key functions: pack phone numbers, name trigrams and dates into index
+  keys.
+*/
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "index.h"
+#include "store.h"
+
+// Entry markers (patient numbers, multi index keys and trigrams are always > 0)
+#define INDEX_EMPTY 0
+#define INDEX_REMOVED -1
+
+// Smallest table allocated by an index (must be a power of 2)
+#define INDEX_MIN_CAPACITY 32
+
+
+//////////////////////////////////////
+// HASH UTILITY FUNCTIONS
+//////////////////////////////////////
+
+// Multiplicative (Fibonacci) hash of an integer key
+static unsigned int hashInt(int key)
+{
+    return (unsigned int)key * 2654435769u;
+}
+
+// Multiplicative (Fibonacci) hash of a 64-bit key
+static unsigned int hashLong(long long key)
+{
+    return (unsigned int)(((unsigned long long)key * 11400714819323198485ull) >> 32);
+}
+
+// Find the entry for a patient number, or the entry where it should be inserted
+static int probePatientIndex(const struct PatientIndex* index, int patientNumber)
+{
+    unsigned int mask = (unsigned int)index->capacity - 1;
+    unsigned int pos = hashInt(patientNumber) & mask;
+    int firstRemoved = -1, probes = 0;
+
+    // A table never fills, but one mapped from a damaged snapshot might, so the probe stops after a lap
+    while (index->entries[pos].patientNumber != INDEX_EMPTY && probes++ < index->capacity)
+    {
+        if (index->entries[pos].patientNumber == patientNumber)
+            return (int)pos;
+
+        if (index->entries[pos].patientNumber == INDEX_REMOVED && firstRemoved == -1)
+            firstRemoved = (int)pos;
+
+        pos = (pos + 1) & mask;
+    }
+
+    return firstRemoved != -1 ? firstRemoved : (int)pos;
+}
+
+// Rebuild the table with a new capacity, dropping removed markers
+static int resizePatientIndex(struct PatientIndex* index, int newCapacity)
+{
+    struct PatientIndex resized = { 0 };
+    int i = 0, pos = 0;
+
+    resized.entries = calloc((size_t)newCapacity, sizeof(struct PatientIndexEntry));
+    if (resized.entries == NULL)
+        return 0;
+    resized.capacity = newCapacity;
+
+    for (i = 0; i < index->capacity; i++)
+    {
+        if (index->entries[i].patientNumber > 0)
+        {
+            pos = probePatientIndex(&resized, index->entries[i].patientNumber);
+            resized.entries[pos] = index->entries[i];
+            resized.count++;
+        }
+    }
+
+    // Tables mapped from a snapshot are released with the snapshot
+    if (!index->borrowed)
+        free(index->entries);
+    *index = resized;
+
+    return 1;
+}
+
+// Find the entry for a key, or the entry where it should be inserted
+static int probeMultiIndex(const struct MultiIndex* index, long long key)
+{
+    unsigned int mask = (unsigned int)index->capacity - 1;
+    unsigned int pos = hashLong(key) & mask;
+    int firstRemoved = -1, probes = 0;
+
+    while (index->entries[pos].key != INDEX_EMPTY && probes++ < index->capacity)
+    {
+        if (index->entries[pos].key == key)
+            return (int)pos;
+
+        if (index->entries[pos].key == INDEX_REMOVED && firstRemoved == -1)
+            firstRemoved = (int)pos;
+
+        pos = (pos + 1) & mask;
+    }
+
+    return firstRemoved != -1 ? firstRemoved : (int)pos;
+}
+
+// Rebuild the multimap table with a new capacity, dropping removed markers
+static int resizeMultiIndex(struct MultiIndex* index, int newCapacity)
+{
+    struct MultiIndexEntry* entries = NULL;
+    struct MultiIndex resized = *index;
+    int i = 0, pos = 0;
+
+    entries = calloc((size_t)newCapacity, sizeof(struct MultiIndexEntry));
+    if (entries == NULL)
+        return 0;
+    resized.entries = entries;
+    resized.capacity = newCapacity;
+    resized.count = 0;
+    resized.removed = 0;
+
+    for (i = 0; i < index->capacity; i++)
+    {
+        if (index->entries[i].key > 0)
+        {
+            pos = probeMultiIndex(&resized, index->entries[i].key);
+            resized.entries[pos] = index->entries[i];
+            resized.count++;
+        }
+    }
+
+    free(index->entries);
+    *index = resized;
+
+    return 1;
+}
+
+// Copy a multimap mapped from a snapshot onto the heap so it can grow
+static int unshareMultiIndex(struct MultiIndex* index)
+{
+    struct MultiIndexEntry* entries = index->entries;
+    int* nextSlot = index->nextSlot;
+    int entriesBorrowed = 1, nextBorrowed = 1, prevBorrowed = 1;
+
+    if (!unshareArray((void**)&index->entries, index->capacity,
+                      sizeof(struct MultiIndexEntry), &entriesBorrowed))
+        return 0;
+    if (!unshareArray((void**)&index->nextSlot, index->slotCapacity, sizeof(int), &nextBorrowed))
+    {
+        free(index->entries);
+        index->entries = entries;
+        return 0;
+    }
+    if (!unshareArray((void**)&index->prevSlot, index->slotCapacity, sizeof(int), &prevBorrowed))
+    {
+        free(index->entries);
+        free(index->nextSlot);
+        index->entries = entries;
+        index->nextSlot = nextSlot;
+        return 0;
+    }
+    index->borrowed = 0;
+
+    return 1;
+}
+
+// Check a chain link stays inside the chain arrays and is matched by the link back
+// (links are mapped from the snapshot unchecked, so each one is checked as it is followed)
+static int isSlotLink(const struct MultiIndex* index, int slot, const int* backLinks, int back)
+{
+    return slot >= 0 && slot < index->slotCapacity && backLinks[slot] == back;
+}
+
+// Check a slot sits on an entry's chain, linked both ways to its neighbours
+static int isSlotLinked(const struct MultiIndex* index, const struct MultiIndexEntry* entry, int slot)
+{
+    int prev = index->prevSlot[slot], next = index->nextSlot[slot];
+
+    return (prev == -1 ? entry->firstSlot == slot : isSlotLink(index, prev, index->nextSlot, slot)) &&
+           (next == -1 ? entry->lastSlot == slot : isSlotLink(index, next, index->prevSlot, slot));
+}
+
+// Check a node link stays inside the node array and is matched by the link back
+static int isNodeLink(const struct NameIndex* index, int node, int back)
+{
+    return node >= 0 && node < index->nodeCapacity && index->nodes[node].prev == back;
+}
+
+// Check a node sits on an entry's chain, linked both ways to its neighbours
+static int isNodeLinked(const struct NameIndex* index, const struct NameIndexEntry* entry, int node)
+{
+    int prev = index->nodes[node].prev, next = index->nodes[node].next;
+
+    return (prev == -1 ? entry->firstNode == node :
+            prev >= 0 && prev < index->nodeCapacity && index->nodes[prev].next == node) &&
+           (next == -1 || isNodeLink(index, next, node));
+}
+
+// Find the entry for a trigram, or the entry where it should be inserted
+static int probeNameIndex(const struct NameIndex* index, int key)
+{
+    unsigned int mask = (unsigned int)index->capacity - 1;
+    unsigned int pos = hashInt(key) & mask;
+    int firstRemoved = -1, probes = 0;
+
+    while (index->entries[pos].key != INDEX_EMPTY && probes++ < index->capacity)
+    {
+        if (index->entries[pos].key == key)
+            return (int)pos;
+
+        if (index->entries[pos].key == INDEX_REMOVED && firstRemoved == -1)
+            firstRemoved = (int)pos;
+
+        pos = (pos + 1) & mask;
+    }
+
+    return firstRemoved != -1 ? firstRemoved : (int)pos;
+}
+
+// Rebuild the trigram table with a new capacity, dropping removed markers
+static int resizeNameIndex(struct NameIndex* index, int newCapacity)
+{
+    struct NameIndexEntry* entries = NULL;
+    struct NameIndex resized = *index;
+    int i = 0, pos = 0;
+
+    entries = calloc((size_t)newCapacity, sizeof(struct NameIndexEntry));
+    if (entries == NULL)
+        return 0;
+    resized.entries = entries;
+    resized.capacity = newCapacity;
+    resized.count = 0;
+    resized.removed = 0;
+
+    for (i = 0; i < index->capacity; i++)
+    {
+        if (index->entries[i].key > 0)
+        {
+            pos = probeNameIndex(&resized, index->entries[i].key);
+            resized.entries[pos] = index->entries[i];
+            resized.count++;
+        }
+    }
+
+    free(index->entries);
+    *index = resized;
+
+    return 1;
+}
+
+// Copy a name index mapped from a snapshot onto the heap so it can grow
+static int unshareNameIndex(struct NameIndex* index)
+{
+    struct NameIndexEntry* entries = index->entries;
+    int entriesBorrowed = 1, nodesBorrowed = 1;
+
+    if (!unshareArray((void**)&index->entries, index->capacity,
+                      sizeof(struct NameIndexEntry), &entriesBorrowed))
+        return 0;
+    if (!unshareArray((void**)&index->nodes, index->nodeCapacity,
+                      sizeof(struct NameIndexNode), &nodesBorrowed))
+    {
+        free(index->entries);
+        index->entries = entries;
+        return 0;
+    }
+    index->borrowed = 0;
+
+    return 1;
+}
+
+
+//////////////////////////////////////
+// PATIENT INDEX FUNCTIONS
+//////////////////////////////////////
+
+// Initialize an empty patient index
+void patientIndexInit(struct PatientIndex* index)
+{
+    memset(index, 0, sizeof(*index));
+}
+
+// Release all memory held by the patient index
+void patientIndexFree(struct PatientIndex* index)
+{
+    if (!index->borrowed)
+        free(index->entries);
+    patientIndexInit(index);
+}
+
+// Copy a patient index into one that shares no memory with it (returns 1 on success, 0 on failure)
+int patientIndexCopy(struct PatientIndex* copy, const struct PatientIndex* index)
+{
+    *copy = *index;
+    copy->borrowed = 1;
+
+    if (!unshareArray((void**)&copy->entries, copy->capacity,
+                      sizeof(struct PatientIndexEntry), &copy->borrowed))
+    {
+        patientIndexInit(copy);
+        return 0;
+    }
+
+    return 1;
+}
+
+// Map a patient number to a store slot (returns 1 on success, 0 on failure)
+int patientIndexInsert(struct PatientIndex* index, int patientNumber, int slot)
+{
+    int pos = 0, newCapacity = index->capacity;
+
+    if (patientNumber <= 0)
+        return 0;
+
+    // Keep the load (live + removed) at or below 1/2 so probes stay short
+    if ((index->count + index->removed + 1) * 2 > index->capacity)
+    {
+        if (newCapacity < INDEX_MIN_CAPACITY)
+            newCapacity = INDEX_MIN_CAPACITY;
+        while ((index->count + 1) * 2 > newCapacity)
+            newCapacity *= 2;
+
+        if (!resizePatientIndex(index, newCapacity))
+            return 0;
+    }
+
+    pos = probePatientIndex(index, patientNumber);
+    if (index->entries[pos].patientNumber != patientNumber)
+    {
+        if (index->entries[pos].patientNumber == INDEX_REMOVED)
+            index->removed--;
+        index->entries[pos].patientNumber = patientNumber;
+        index->count++;
+    }
+    index->entries[pos].slot = slot;
+
+    return 1;
+}
+
+// Remove a patient number from the index
+void patientIndexRemove(struct PatientIndex* index, int patientNumber)
+{
+    int pos = 0;
+
+    if (index->capacity == 0 || patientNumber <= 0)
+        return;
+
+    pos = probePatientIndex(index, patientNumber);
+    if (index->entries[pos].patientNumber == patientNumber)
+    {
+        index->entries[pos].patientNumber = INDEX_REMOVED;
+        index->entries[pos].slot = -1;
+        index->count--;
+        index->removed++;
+    }
+}
+
+// Find the store slot for a patient number (returns -1 if not found)
+int patientIndexFind(const struct PatientIndex* index, int patientNumber)
+{
+    int pos = 0;
+
+    if (index->capacity == 0 || patientNumber <= 0)
+        return -1;
+
+    pos = probePatientIndex(index, patientNumber);
+
+    return index->entries[pos].patientNumber == patientNumber ? index->entries[pos].slot : -1;
+}
+
+
+//////////////////////////////////////
+// MULTI INDEX FUNCTIONS
+//////////////////////////////////////
+
+// Initialize an empty multi index
+void multiIndexInit(struct MultiIndex* index)
+{
+    memset(index, 0, sizeof(*index));
+}
+
+// Release all memory held by the multi index
+void multiIndexFree(struct MultiIndex* index)
+{
+    if (!index->borrowed)
+    {
+        free(index->entries);
+        free(index->nextSlot);
+        free(index->prevSlot);
+    }
+    multiIndexInit(index);
+}
+
+// Copy a multi index into one that shares no memory with it (returns 1 on success, 0 on failure)
+int multiIndexCopy(struct MultiIndex* copy, const struct MultiIndex* index)
+{
+    *copy = *index;
+
+    if (!unshareMultiIndex(copy))
+    {
+        multiIndexInit(copy);
+        return 0;
+    }
+
+    return 1;
+}
+
+// Add a store slot to the end of a key's chain (returns 1 on success, 0 on failure)
+int multiIndexInsert(struct MultiIndex* index, long long key, int slot)
+{
+    int pos = 0, last = -1, newCapacity = index->capacity, prevCapacity = index->slotCapacity;
+
+    if (key <= 0 || slot < 0)
+        return 0;
+
+    if (index->borrowed && !unshareMultiIndex(index))
+        return 0;
+
+    // The backward links grow first: if the forward ones then fail to grow, the spare room is harmless
+    if (!growArray((void**)&index->prevSlot, &prevCapacity, slot + 1, sizeof(int)) ||
+        !growArray((void**)&index->nextSlot, &index->slotCapacity, slot + 1, sizeof(int)))
+        return 0;
+
+    if ((index->count + index->removed + 1) * 2 > index->capacity)
+    {
+        if (newCapacity < INDEX_MIN_CAPACITY)
+            newCapacity = INDEX_MIN_CAPACITY;
+        while ((index->count + 1) * 2 > newCapacity)
+            newCapacity *= 2;
+
+        if (!resizeMultiIndex(index, newCapacity))
+            return 0;
+    }
+
+    pos = probeMultiIndex(index, key);
+    if (index->entries[pos].key != key)
+    {
+        if (index->entries[pos].key == INDEX_REMOVED)
+            index->removed--;
+        index->entries[pos].key = key;
+        index->entries[pos].firstSlot = -1;
+        index->entries[pos].lastSlot = -1;
+        index->count++;
+    }
+
+    // Chains run in the order slots were added, so the tail takes the new slot
+    last = index->entries[pos].lastSlot;
+    if (last == -1 ? index->entries[pos].firstSlot != -1 : !isSlotLink(index, last, index->nextSlot, -1))
+        return 0;
+    index->nextSlot[slot] = -1;
+    index->prevSlot[slot] = last;
+    if (last == -1)
+        index->entries[pos].firstSlot = slot;
+    else
+        index->nextSlot[last] = slot;
+    index->entries[pos].lastSlot = slot;
+
+    return 1;
+}
+
+// Remove a store slot from under a key
+void multiIndexRemove(struct MultiIndex* index, long long key, int slot)
+{
+    int pos = 0, prev = -1, next = -1;
+
+    if (index->capacity == 0 || key <= 0 || slot < 0 || slot >= index->slotCapacity)
+        return;
+
+    pos = probeMultiIndex(index, key);
+    if (index->entries[pos].key != key)
+        return;
+
+    if (!isSlotLinked(index, &index->entries[pos], slot))
+        return;
+    prev = index->prevSlot[slot];
+    next = index->nextSlot[slot];
+
+    if (prev == -1)
+        index->entries[pos].firstSlot = next;
+    else
+        index->nextSlot[prev] = next;
+    if (next == -1)
+        index->entries[pos].lastSlot = prev;
+    else
+        index->prevSlot[next] = prev;
+    index->nextSlot[slot] = index->prevSlot[slot] = -1;
+
+    if (index->entries[pos].firstSlot == -1)
+    {
+        index->entries[pos].key = INDEX_REMOVED;
+        index->count--;
+        index->removed++;
+    }
+}
+
+// Get the first store slot with a key (returns -1 if none)
+int multiIndexFirst(const struct MultiIndex* index, long long key)
+{
+    int pos = 0, first = -1;
+
+    if (index->capacity == 0 || key <= 0)
+        return -1;
+
+    pos = probeMultiIndex(index, key);
+    if (index->entries[pos].key == key)
+        first = index->entries[pos].firstSlot;
+
+    return isSlotLink(index, first, index->prevSlot, -1) ? first : -1;
+}
+
+// Get the next store slot sharing the same key (returns -1 if none)
+int multiIndexNext(const struct MultiIndex* index, int slot)
+{
+    int next = index->nextSlot[slot];
+
+    // Every slot links back to the one before it, so a damaged chain cannot loop
+    return isSlotLink(index, next, index->prevSlot, slot) ? next : -1;
+}
+
+
+//////////////////////////////////////
+// NAME INDEX FUNCTIONS
+//////////////////////////////////////
+
+// Initialize an empty name index
+void nameIndexInit(struct NameIndex* index)
+{
+    memset(index, 0, sizeof(*index));
+}
+
+// Release all memory held by the name index
+void nameIndexFree(struct NameIndex* index)
+{
+    if (!index->borrowed)
+    {
+        free(index->entries);
+        free(index->nodes);
+    }
+    nameIndexInit(index);
+}
+
+// Copy a name index into one that shares no memory with it (returns 1 on success, 0 on failure)
+int nameIndexCopy(struct NameIndex* copy, const struct NameIndex* index)
+{
+    *copy = *index;
+    copy->borrowed = 1;
+
+    if (!unshareNameIndex(copy))
+    {
+        nameIndexInit(copy);
+        return 0;
+    }
+
+    return 1;
+}
+
+// Add the trigrams of the name in a store slot (returns 1 on success, 0 on failure)
+int nameIndexInsert(struct NameIndex* index, int slot, const char* name)
+{
+    char normalized[NAME_INDEX_TRIGRAMS] = { 0 };
+    int trigrams[NAME_INDEX_TRIGRAMS];
+    int count = 0, i = 0, pos = 0, node = 0, newCapacity = index->capacity;
+
+    if (slot < 0)
+        return 0;
+
+    normalizeName(name, normalized, (int)sizeof(normalized));
+    count = nameTrigrams(normalized, 0, trigrams);
+    if (count == 0)
+        return 1;
+
+    if (index->borrowed && !unshareNameIndex(index))
+        return 0;
+
+    if (!growArray((void**)&index->nodes, &index->nodeCapacity,
+                   (slot + 1) * NAME_INDEX_TRIGRAMS, sizeof(struct NameIndexNode)))
+        return 0;
+
+    // Room for every trigram up front, so linking the nodes cannot fail halfway
+    if ((index->count + index->removed + count) * 2 > index->capacity)
+    {
+        if (newCapacity < INDEX_MIN_CAPACITY)
+            newCapacity = INDEX_MIN_CAPACITY;
+        while ((index->count + count) * 2 > newCapacity)
+            newCapacity *= 2;
+
+        if (!resizeNameIndex(index, newCapacity))
+            return 0;
+    }
+
+    // Nor can a chain with a damaged head, so every head is checked first
+    for (i = 0; i < count; i++)
+    {
+        pos = probeNameIndex(index, trigrams[i]);
+        if (index->entries[pos].key == trigrams[i] && index->entries[pos].firstNode != -1 &&
+            !isNodeLink(index, index->entries[pos].firstNode, -1))
+            return 0;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        pos = probeNameIndex(index, trigrams[i]);
+        if (index->entries[pos].key != trigrams[i])
+        {
+            if (index->entries[pos].key == INDEX_REMOVED)
+                index->removed--;
+            index->entries[pos].key = trigrams[i];
+            index->entries[pos].firstNode = -1;
+            index->entries[pos].count = 0;
+            index->count++;
+        }
+
+        // New nodes go on the front of the chain, so chains run newest first
+        node = slot * NAME_INDEX_TRIGRAMS + i;
+        index->nodes[node].next = index->entries[pos].firstNode;
+        index->nodes[node].prev = -1;
+        if (index->entries[pos].firstNode != -1)
+            index->nodes[index->entries[pos].firstNode].prev = node;
+        index->entries[pos].firstNode = node;
+        index->entries[pos].count++;
+    }
+
+    return 1;
+}
+
+// Remove the trigrams of the name in a store slot (the name it was added with)
+void nameIndexRemove(struct NameIndex* index, int slot, const char* name)
+{
+    char normalized[NAME_INDEX_TRIGRAMS] = { 0 };
+    int trigrams[NAME_INDEX_TRIGRAMS];
+    int count = 0, i = 0, pos = 0, node = 0;
+    struct NameIndexNode* links = NULL;
+
+    if (index->capacity == 0)
+        return;
+
+    normalizeName(name, normalized, (int)sizeof(normalized));
+    count = nameTrigrams(normalized, 0, trigrams);
+
+    for (i = 0; i < count; i++)
+    {
+        pos = probeNameIndex(index, trigrams[i]);
+        if (index->entries[pos].key != trigrams[i])
+            continue;
+
+        node = slot * NAME_INDEX_TRIGRAMS + i;
+        if (node >= index->nodeCapacity || !isNodeLinked(index, &index->entries[pos], node))
+            continue;
+        links = &index->nodes[node];
+        if (links->prev == -1)
+            index->entries[pos].firstNode = links->next;
+        else
+            index->nodes[links->prev].next = links->next;
+        if (links->next != -1)
+            index->nodes[links->next].prev = links->prev;
+        links->next = links->prev = -1;
+
+        if (--index->entries[pos].count == 0)
+        {
+            index->entries[pos].key = INDEX_REMOVED;
+            index->count--;
+            index->removed++;
+        }
+    }
+}
+
+// Get the first node of a trigram's chain (returns -1 if none; the node's slot is node / NAME_INDEX_TRIGRAMS)
+int nameIndexFirst(const struct NameIndex* index, int trigram)
+{
+    int pos = 0, first = -1;
+
+    if (index->capacity == 0 || trigram <= 0)
+        return -1;
+
+    pos = probeNameIndex(index, trigram);
+    if (index->entries[pos].key == trigram)
+        first = index->entries[pos].firstNode;
+
+    return isNodeLink(index, first, -1) ? first : -1;
+}
+
+// Get the next node in the same trigram's chain (returns -1 if none)
+int nameIndexNext(const struct NameIndex* index, int node)
+{
+    int next = index->nodes[node].next;
+
+    return isNodeLink(index, next, node) ? next : -1;
+}
+
+// Get the number of names with a trigram
+int nameIndexCount(const struct NameIndex* index, int trigram)
+{
+    int pos = 0;
+
+    if (index->capacity == 0 || trigram <= 0)
+        return 0;
+
+    pos = probeNameIndex(index, trigram);
+
+    return index->entries[pos].key == trigram ? index->entries[pos].count : 0;
+}
+
+
+//////////////////////////////////////
+// DAY BITMAP FUNCTIONS
+//////////////////////////////////////
+
+// Initialize an empty day bitmap
+void dayBitmapInit(struct DayBitmap* bitmap)
+{
+    memset(bitmap, 0, sizeof(*bitmap));
+}
+
+// Release all memory held by the day bitmap
+void dayBitmapFree(struct DayBitmap* bitmap)
+{
+    if (!bitmap->borrowed)
+        free(bitmap->words);
+    dayBitmapInit(bitmap);
+}
+
+// Copy a day bitmap's window into one that shares no memory with it (returns 1 on success, 0 on failure)
+int dayBitmapCopy(struct DayBitmap* copy, const struct DayBitmap* bitmap)
+{
+    *copy = *bitmap;
+    copy->capacity = copy->count;
+    copy->borrowed = 1;
+
+    if (!unshareArray((void**)&copy->words, copy->count,
+                      sizeof(unsigned long long), &copy->borrowed))
+    {
+        dayBitmapInit(copy);
+        return 0;
+    }
+
+    return 1;
+}
+
+// Make room for every key from firstKey to lastKey (returns 1 on success, 0 on failure)
+int dayBitmapReserve(struct DayBitmap* bitmap, int firstKey, int lastKey)
+{
+    int shift = 0;
+
+    if (bitmap->count > 0)
+    {
+        if (firstKey > bitmap->firstKey)
+            firstKey = bitmap->firstKey;
+        if (lastKey < bitmap->firstKey + bitmap->count - 1)
+            lastKey = bitmap->firstKey + bitmap->count - 1;
+        shift = bitmap->firstKey - firstKey;
+    }
+
+    if (lastKey - firstKey + 1 > bitmap->capacity &&
+        !unshareArray((void**)&bitmap->words, bitmap->capacity,
+                      sizeof(unsigned long long), &bitmap->borrowed))
+        return 0;
+    if (!growArray((void**)&bitmap->words, &bitmap->capacity,
+                   lastKey - firstKey + 1, sizeof(unsigned long long)))
+        return 0;
+
+    // Words past the window are always zero, so only an earlier first key needs work
+    if (shift > 0)
+    {
+        memmove(&bitmap->words[shift], bitmap->words,
+                (size_t)bitmap->count * sizeof(unsigned long long));
+        memset(bitmap->words, 0, (size_t)shift * sizeof(unsigned long long));
+    }
+    bitmap->firstKey = firstKey;
+    bitmap->count = lastKey - firstKey + 1;
+
+    return 1;
+}
+
+// Set bits of a key (returns 1 on success, 0 on failure)
+int dayBitmapSet(struct DayBitmap* bitmap, int key, unsigned long long bits)
+{
+    if (!dayBitmapReserve(bitmap, key, key))
+        return 0;
+
+    bitmap->words[key - bitmap->firstKey] |= bits;
+
+    return 1;
+}
+
+// Clear bits of a key
+void dayBitmapClear(struct DayBitmap* bitmap, int key, unsigned long long bits)
+{
+    if (key >= bitmap->firstKey && key - bitmap->firstKey < bitmap->count)
+        bitmap->words[key - bitmap->firstKey] &= ~bits;
+}
+
+// Get the bits of a key (0 for a key with none set)
+unsigned long long dayBitmapGet(const struct DayBitmap* bitmap, int key)
+{
+    return key >= bitmap->firstKey && key - bitmap->firstKey < bitmap->count ?
+           bitmap->words[key - bitmap->firstKey] : 0;
+}
+
+// Find the first of key, key + stride, ... up to lastKey with a clear bit in 'mask' (returns -1 if none)
+int dayBitmapNextClear(const struct DayBitmap* bitmap, int key, int lastKey, int stride,
+                       unsigned long long mask)
+{
+    int end = bitmap->firstKey + bitmap->count;
+
+    if (mask == 0 || key > lastKey)
+        return -1;
+
+    // Keys outside the window have nothing set, so only the words inside it are scanned
+    if (key >= bitmap->firstKey)
+    {
+        while (key < end && key <= lastKey &&
+               (bitmap->words[key - bitmap->firstKey] & mask) == mask)
+            key += stride;
+    }
+
+    return key <= lastKey ? key : -1;
+}
+
+// Get the position of the lowest set bit (bits must not be 0)
+int lowestBit(unsigned long long bits)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(bits);
+#else
+    int position = 0;
+
+    while ((bits & 1u) == 0)
+    {
+        bits >>= 1;
+        position++;
+    }
+
+    return position;
+#endif
+}
+
+
+//////////////////////////////////////
+// KEY FUNCTIONS
+//////////////////////////////////////
+
+// Pack a 10-digit phone number string into an index key (returns 0 if not a valid number)
+long long phoneKeyFromString(const char* phoneNumber)
+{
+    long long key = 0;
+    int i = 0;
+
+    for (i = 0; i < 10; i++)
+    {
+        if (phoneNumber[i] < '0' || phoneNumber[i] > '9')
+            return 0;
+        key = key * 10 + (phoneNumber[i] - '0');
+    }
+
+    // Offset by one so "0000000000" does not collide with the empty marker
+    return phoneNumber[i] == '\0' ? key + 1 : 0;
+}
+
+// Unpack an index key into a 10-digit phone number string (empty if the key is 0)
+void phoneStringFromKey(long long key, char* phoneNumber)
+{
+    int i = 0;
+
+    phoneNumber[key > 0 ? 10 : 0] = '\0';
+
+    // Undo the offset, then write the digits from the last one back (keeping leading zeros)
+    for (i = 9, key -= 1; key >= 0 && i >= 0; i--, key /= 10)
+        phoneNumber[i] = (char)('0' + key % 10);
+}
+
+// Normalize a name for searching: lowercase words split on anything but letters and digits, joined by
+// single spaces (keeps up to size - 1 characters, returns the length)
+int normalizeName(const char* name, char* normalized, int size)
+{
+    int length = 0, isGap = 0;
+    unsigned char c = 0;
+
+    for (; *name != '\0'; name++)
+    {
+        // Bytes past ASCII (accented letters in UTF-8) count as letters
+        c = (unsigned char)*name;
+        if (c >= 0x80 || isalnum(c))
+        {
+            // One space between words, and only if a letter fits after it
+            if (isGap && length > 0 && length < size - 2)
+                normalized[length++] = ' ';
+            if (length < size - 1)
+                normalized[length++] = (char)tolower(c);
+            isGap = 0;
+        }
+        else
+            isGap = 1;
+    }
+    normalized[length] = '\0';
+
+    return length;
+}
+
+// Add a trigram to a list unless it is already there or the list is full
+static void addTrigram(int* trigrams, int* count, int trigram)
+{
+    int i = 0;
+
+    for (i = 0; i < *count; i++)
+    {
+        if (trigrams[i] == trigram)
+            return;
+    }
+
+    if (*count < NAME_INDEX_TRIGRAMS)
+        trigrams[(*count)++] = trigram;
+}
+
+// Get the distinct trigrams of a normalized name's words, each padded as "  word " (the last word
+// without its trailing space if isPrefix); fills up to NAME_INDEX_TRIGRAMS, returns # found
+int nameTrigrams(const char* normalized, int isPrefix, int* trigrams)
+{
+    const char* word = normalized;
+    int count = 0, length = 0, last = 0, i = 0, key = 0;
+
+    while (*word != '\0')
+    {
+        length = (int)strcspn(word, " ");
+        last = word[length] == '\0' && isPrefix ? length - 1 : length;
+
+        // A trigram key is three characters, one per byte, so padding and letters are never 0
+        key = (' ' << 8) | ' ';
+        for (i = 0; i <= last; i++)
+        {
+            key = ((key << 8) | (i < length ? (unsigned char)word[i] : ' ')) & 0xFFFFFF;
+            addTrigram(trigrams, &count, key);
+        }
+
+        word += word[length] == ' ' ? length + 1 : length;
+    }
+
+    return count;
+}
+
+// Get the calendar day key of a date (keys sort in date order, returns 0 if invalid)
+int dayKeyFromDate(int year, int month, int day)
+{
+    // Every month spans 31 keys so any date accepted by inputDate maps uniquely
+    if (year <= 0 || month < 1 || month > 12 || day < 1 || day > 31)
+        return 0;
+
+    return (year * 12 + (month - 1)) * 31 + day;
+}
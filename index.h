@@ -0,0 +1,219 @@
+#ifndef INDEX_H
+#define INDEX_H
+
+// Most trigrams a name index keeps for one name (a name of NAME_LEN characters has at most NAME_LEN + 1)
+#define NAME_INDEX_TRIGRAMS 16
+
+//////////////////////////////////////
+// Structures
+//////////////////////////////////////
+
+// Data type: Patient Index entry (key 0 = empty, key -1 = removed)
+struct PatientIndexEntry
+{
+    int patientNumber;
+    int slot;
+};
+
+// Data type: Patient Index (open-addressing hash: patient number -> store slot)
+struct PatientIndex
+{
+    struct PatientIndexEntry* entries;
+    int capacity;
+    int count;
+    int removed;
+    int borrowed;
+};
+
+// Data type: Multi Index entry (key 0 = empty, key -1 = removed)
+struct MultiIndexEntry
+{
+    long long key;
+    int firstSlot;
+    int lastSlot;
+};
+
+// Data type: Multi Index (multimap: key -> doubly linked chain of store slots in the order they were added)
+struct MultiIndex
+{
+    struct MultiIndexEntry* entries;
+    int capacity;
+    int count;
+    int removed;
+    int* nextSlot;
+    int* prevSlot;
+    int slotCapacity;
+    int borrowed;
+};
+
+// Data type: Name Index entry (key 0 = empty, key -1 = removed; count = nodes in the chain)
+struct NameIndexEntry
+{
+    int key;
+    int firstNode;
+    int count;
+};
+
+// Data type: Name Index Node (the neighbours of one name trigram in its trigram's chain)
+struct NameIndexNode
+{
+    int next;
+    int prev;
+};
+
+// Data type: Name Index (trigram postings: trigram -> chain of nodes; node
+// slot * NAME_INDEX_TRIGRAMS + i stands for the i-th trigram of the name in that store slot)
+struct NameIndex
+{
+    struct NameIndexEntry* entries;
+    int capacity;
+    int count;
+    int removed;
+    struct NameIndexNode* nodes;
+    int nodeCapacity;
+    int borrowed;
+};
+
+// Data type: Day Bitmap (one 64-bit word per key, for keys firstKey to firstKey + count - 1;
+// keys are day keys, or a day key times a stride plus an offset when a day needs several words)
+struct DayBitmap
+{
+    unsigned long long* words;
+    int firstKey;
+    int count;
+    int capacity;
+    int borrowed;
+};
+
+//////////////////////////////////////
+// PATIENT INDEX FUNCTIONS
+//////////////////////////////////////
+
+// Initialize an empty patient index
+void patientIndexInit(struct PatientIndex* index);
+
+// Release all memory held by the patient index
+void patientIndexFree(struct PatientIndex* index);
+
+// Copy a patient index into one that shares no memory with it (returns 1 on success, 0 on failure)
+int patientIndexCopy(struct PatientIndex* copy, const struct PatientIndex* index);
+
+// Map a patient number to a store slot (returns 1 on success, 0 on failure)
+int patientIndexInsert(struct PatientIndex* index, int patientNumber, int slot);
+
+// Remove a patient number from the index
+void patientIndexRemove(struct PatientIndex* index, int patientNumber);
+
+// Find the store slot for a patient number (returns -1 if not found)
+int patientIndexFind(const struct PatientIndex* index, int patientNumber);
+
+
+//////////////////////////////////////
+// MULTI INDEX FUNCTIONS
+//////////////////////////////////////
+
+// Initialize an empty multi index
+void multiIndexInit(struct MultiIndex* index);
+
+// Release all memory held by the multi index
+void multiIndexFree(struct MultiIndex* index);
+
+// Copy a multi index into one that shares no memory with it (returns 1 on success, 0 on failure)
+int multiIndexCopy(struct MultiIndex* copy, const struct MultiIndex* index);
+
+// Add a store slot to the end of a key's chain (returns 1 on success, 0 on failure)
+int multiIndexInsert(struct MultiIndex* index, long long key, int slot);
+
+// Remove a store slot from under a key
+void multiIndexRemove(struct MultiIndex* index, long long key, int slot);
+
+// Get the first store slot with a key (returns -1 if none)
+int multiIndexFirst(const struct MultiIndex* index, long long key);
+
+// Get the next store slot sharing the same key (returns -1 if none)
+int multiIndexNext(const struct MultiIndex* index, int slot);
+
+
+//////////////////////////////////////
+// NAME INDEX FUNCTIONS
+//////////////////////////////////////
+
+// Initialize an empty name index
+void nameIndexInit(struct NameIndex* index);
+
+// Release all memory held by the name index
+void nameIndexFree(struct NameIndex* index);
+
+// Copy a name index into one that shares no memory with it (returns 1 on success, 0 on failure)
+int nameIndexCopy(struct NameIndex* copy, const struct NameIndex* index);
+
+// Add the trigrams of the name in a store slot (returns 1 on success, 0 on failure)
+int nameIndexInsert(struct NameIndex* index, int slot, const char* name);
+
+// Remove the trigrams of the name in a store slot (the name it was added with)
+void nameIndexRemove(struct NameIndex* index, int slot, const char* name);
+
+// Get the first node of a trigram's chain (returns -1 if none; the node's slot is node / NAME_INDEX_TRIGRAMS)
+int nameIndexFirst(const struct NameIndex* index, int trigram);
+
+// Get the next node in the same trigram's chain (returns -1 if none)
+int nameIndexNext(const struct NameIndex* index, int node);
+
+// Get the number of names with a trigram
+int nameIndexCount(const struct NameIndex* index, int trigram);
+
+
+//////////////////////////////////////
+// DAY BITMAP FUNCTIONS
+//////////////////////////////////////
+
+// Initialize an empty day bitmap
+void dayBitmapInit(struct DayBitmap* bitmap);
+
+// Release all memory held by the day bitmap
+void dayBitmapFree(struct DayBitmap* bitmap);
+
+// Copy a day bitmap's window into one that shares no memory with it (returns 1 on success, 0 on failure)
+int dayBitmapCopy(struct DayBitmap* copy, const struct DayBitmap* bitmap);
+
+// Make room for every key from firstKey to lastKey (returns 1 on success, 0 on failure)
+int dayBitmapReserve(struct DayBitmap* bitmap, int firstKey, int lastKey);
+
+// Set bits of a key (returns 1 on success, 0 on failure)
+int dayBitmapSet(struct DayBitmap* bitmap, int key, unsigned long long bits);
+
+// Clear bits of a key
+void dayBitmapClear(struct DayBitmap* bitmap, int key, unsigned long long bits);
+
+// Get the bits of a key (0 for a key with none set)
+unsigned long long dayBitmapGet(const struct DayBitmap* bitmap, int key);
+
+// Find the first of key, key + stride, ... up to lastKey with a clear bit in 'mask' (returns -1 if none)
+int dayBitmapNextClear(const struct DayBitmap* bitmap, int key, int lastKey, int stride,
+                       unsigned long long mask);
+
+// Get the position of the lowest set bit (bits must not be 0)
+int lowestBit(unsigned long long bits);
+
+//////////////////////////////////////
+// KEY FUNCTIONS
+//////////////////////////////////////
+
+// Pack a 10-digit phone number string into an index key (returns 0 if not a valid number)
+long long phoneKeyFromString(const char* phoneNumber);
+
+// Unpack an index key into a 10-digit phone number string (empty if the key is 0)
+void phoneStringFromKey(long long key, char* phoneNumber);
+
+// Normalize a name for searching: lowercase words split on anything but letters and digits, joined by
+// single spaces (keeps up to size - 1 characters, returns the length)
+int normalizeName(const char* name, char* normalized, int size);
+
+// Get the distinct trigrams of a normalized name's words, each padded as "  word " (the last word
+// without its trailing space if isPrefix); fills up to NAME_INDEX_TRIGRAMS, returns # found
+int nameTrigrams(const char* normalized, int isPrefix, int* trigrams);
+
+// Get the calendar day key of a date (keys sort in date order, returns 0 if invalid)
+int dayKeyFromDate(int year, int month, int day);
+
+#endif // !INDEX_H
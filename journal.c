@@ -0,0 +1,703 @@
+/*
+Journal module
+- Journal functions: append-only log of patient and appointment
+  changes, replayed over the snapshot at startup.
+- Records are queued by the caller and written by a flusher thread;
+  every record queued while a flush is in progress shares the next
+  write and fsync (group commit).
+- Compaction writes a new snapshot from a copy of the store on a
+  background thread and then drops the journal records it already holds.
+*/
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+#include "clinic.h"
+#include "journal.h"
+#include "loader.h"
+#include "snapshot.h"
+#include "store.h"
+
+// File identification
+#define JOURNAL_MAGIC "VETJRNL"
+#define JOURNAL_BYTE_ORDER 0x01020304u
+
+//////////////////////////////////////
+// Structures
+//////////////////////////////////////
+
+// Data type: Journal Header (start of every journal file)
+struct JournalHeader
+{
+    char magic[8];
+    unsigned int version;
+    unsigned int byteOrder;
+    int recordSize;
+    unsigned int checksum;
+};
+
+// Data type: Journal Record (one change, stored as a fixed-size block)
+struct JournalRecord
+{
+    unsigned long long lsn;
+    int type;
+    int slot;
+    union
+    {
+        struct Patient patient;
+        struct Appointment appoint;
+    } item;
+    unsigned int checksum;
+};
+
+// Data type: Journal (open journal file and its group-commit writer)
+struct Journal
+{
+    char journalFile[FILENAME_MAX];
+    char snapshotFile[FILENAME_MAX];
+    FILE* fp;
+    long fileSize;
+    int failed;
+    int reported;
+    int deferSync;
+    struct JournalRecord* pending;
+    int pendingCount;
+    int pendingCapacity;
+#ifndef _WIN32
+    struct JournalRecord* spare;
+    int spareCapacity;
+    unsigned long long durableLsn;
+    int flushing;
+    int stopping;
+    pthread_t flusher;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    pthread_t compactor;
+    int compacting;
+    int compactDone;
+    int compactSaved;
+    long compactOffset;
+    struct ClinicData compactCopy;
+#endif
+};
+
+
+//////////////////////////////////////
+// JOURNAL HELPER FUNCTIONS
+//////////////////////////////////////
+
+// Report a journal record that could not be replayed
+static void reportJournalError(const char* journalFile, int recordNumber, const char* message)
+{
+    fprintf(stderr, "ERROR: %s record %d: %s\n", journalFile, recordNumber, message);
+}
+
+// Fill in a journal header for this build
+static void makeJournalHeader(struct JournalHeader* header)
+{
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+    header->version = JOURNAL_VERSION;
+    header->byteOrder = JOURNAL_BYTE_ORDER;
+    header->recordSize = (int)sizeof(struct JournalRecord);
+    header->checksum = checksumBytes(CHECKSUM_SEED, header, sizeof(*header));
+}
+
+// Check a journal file starts with the header this build writes
+static int isJournalHeaderValid(const char* text, long length)
+{
+    struct JournalHeader header;
+
+    makeJournalHeader(&header);
+
+    return length >= (long)sizeof(header) && memcmp(text, &header, sizeof(header)) == 0;
+}
+
+// Checksum a record with its own checksum field cleared
+static unsigned int checksumRecord(const struct JournalRecord* record)
+{
+    struct JournalRecord copy = *record;
+
+    copy.checksum = 0;
+
+    return checksumBytes(CHECKSUM_SEED, &copy, sizeof(copy));
+}
+
+// Replace a journal file with a header and the given records (returns 1 on success, 0 on failure)
+static int writeJournalFile(const char* journalFile, const char* records, long length)
+{
+    struct JournalHeader header;
+    char tempFile[FILENAME_MAX] = { 0 };
+    int written = 0;
+    FILE* fp = NULL;
+
+    makeJournalHeader(&header);
+    strcpy(tempFile, journalFile);
+    strcat(tempFile, ".tmp");
+
+    fp = fopen(tempFile, "wb");
+    if (fp == NULL)
+        return 0;
+
+    written = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+              (length == 0 || fwrite(records, 1, (size_t)length, fp) == (size_t)length) &&
+              syncFile(fp);
+
+    if (fclose(fp) != 0)
+        written = 0;
+
+#ifdef _WIN32
+    if (written)
+        remove(journalFile);
+#endif
+    if (!written || rename(tempFile, journalFile) != 0)
+    {
+        remove(tempFile);
+        written = 0;
+    }
+
+    return written && syncDirectory(journalFile);
+}
+
+// Check the patient in 'slot' has the given patient number
+static int isPatientInSlot(const struct ClinicData* data, int slot, int patientNumber)
+{
+    return slot >= 0 && slot < data->patientCount &&
+           data->patients[slot].patientNumber == patientNumber;
+}
+
+// Apply one journal record to the clinic data (returns 1 on success, 0 if it does not fit)
+static int applyRecord(struct ClinicData* data, const struct JournalRecord* record)
+{
+    const struct Patient* patient = &record->item.patient;
+    const struct Appointment* appoint = &record->item.appoint;
+    int slot = record->slot, applied = 0;
+
+    switch (record->type)
+    {
+    case JOURNAL_ADD_PATIENT:
+        if (findPatientIndexByPatientNum(patient->patientNumber, data) == -1 &&
+            storeClaimPatientSlot(data, slot))
+        {
+            data->patients[slot] = *patient;
+            applied = storeIndexPatient(data, slot);
+            if (!applied)
+                storeRemovePatient(data, slot);
+        }
+        break;
+
+    case JOURNAL_EDIT_PATIENT:
+        applied = isPatientInSlot(data, slot, patient->patientNumber) &&
+                  storeUpdatePatientPhone(data, slot, patient->phoneType, patient->phoneKey) &&
+                  storeUpdatePatientName(data, slot, patient->name);
+        break;
+
+    case JOURNAL_REMOVE_PATIENT:
+        if (isPatientInSlot(data, slot, patient->patientNumber))
+        {
+            storeRemovePatientAppointments(data, patient->patientNumber);
+            storeRemovePatient(data, slot);
+            applied = 1;
+        }
+        break;
+
+    case JOURNAL_ADD_APPOINTMENT:
+        applied = storeInsertAppointment(data, appoint) != -1;
+        break;
+
+    case JOURNAL_REMOVE_APPOINTMENT:
+        slot = storeFindAppointment(data, appoint);
+        if (slot != -1)
+        {
+            storeRemoveAppointment(data, slot);
+            applied = 1;
+        }
+        break;
+    }
+
+    return applied;
+}
+
+// Replay the records the snapshot does not hold yet (returns the length of the undamaged part)
+static long replayJournal(const char* journalFile, const char* text, long length,
+                          struct ClinicData* data, int* replayed)
+{
+    struct JournalRecord record;
+    long offset = (long)sizeof(struct JournalHeader);
+    int recordNumber = 0, damaged = 0;
+
+    while (!damaged && length - offset >= (long)sizeof(record))
+    {
+        memcpy(&record, text + offset, sizeof(record));
+        recordNumber++;
+
+        if (record.checksum != checksumRecord(&record))
+        {
+            reportJournalError(journalFile, recordNumber, "damaged record, dropping the rest of the journal");
+            damaged = 1;
+        }
+        else
+        {
+            // Records up to the snapshot's LSN were compacted into it already
+            if (record.lsn > data->lastLsn)
+            {
+                if (applyRecord(data, &record))
+                    (*replayed)++;
+                else
+                    reportJournalError(journalFile, recordNumber, "change does not match the snapshot");
+                data->lastLsn = record.lsn;
+            }
+            offset += (long)sizeof(record);
+        }
+    }
+
+    // A record cut short by a crash was never acknowledged, so it is dropped
+    if (!damaged && offset != length)
+        reportJournalError(journalFile, recordNumber + 1, "incomplete record dropped");
+
+    return offset;
+}
+
+// Rewrite the journal without the records before 'offset' (nothing may be flushing)
+static int trimJournal(struct Journal* journal, long offset)
+{
+    long tailLength = journal->fileSize - offset;
+    char* tail = malloc((size_t)tailLength + 1);
+    int trimmed = 0;
+    FILE* fp = NULL;
+
+    if (tail != NULL && (fp = fopen(journal->journalFile, "rb")) != NULL)
+    {
+        trimmed = fseek(fp, offset, SEEK_SET) == 0 &&
+                  fread(tail, 1, (size_t)tailLength, fp) == (size_t)tailLength;
+        fclose(fp);
+    }
+
+    // The journal is closed while it is replaced so the rename also works on Windows
+    fclose(journal->fp);
+    trimmed = trimmed && writeJournalFile(journal->journalFile, tail, tailLength);
+    if (trimmed)
+        journal->fileSize = (long)sizeof(struct JournalHeader) + tailLength;
+
+    journal->fp = fopen(journal->journalFile, "ab");
+    if (journal->fp == NULL)
+        journal->failed = 1;
+
+    free(tail);
+
+    return trimmed;
+}
+
+// Report the first failed journal write (later changes are refused)
+static void reportJournalFailure(struct Journal* journal)
+{
+    if (!journal->reported)
+        fprintf(stderr, "ERROR: Could not write %s (no further changes will be made)\n",
+                journal->journalFile);
+    journal->reported = 1;
+}
+
+#ifndef _WIN32
+// Flusher thread: write queued records in batches, one fsync per batch
+static void* runFlusher(void* arg)
+{
+    struct Journal* journal = arg;
+    struct JournalRecord* batch = NULL;
+    int count = 0, capacity = 0, written = 0;
+
+    pthread_mutex_lock(&journal->lock);
+    while (!journal->stopping || journal->pendingCount > 0)
+    {
+        if (journal->pendingCount == 0)
+            pthread_cond_wait(&journal->wake, &journal->lock);
+        else
+        {
+            // Take every record queued so far; new ones queue in the spare buffer meanwhile
+            batch = journal->pending;
+            count = journal->pendingCount;
+            capacity = journal->pendingCapacity;
+            journal->pending = journal->spare;
+            journal->pendingCapacity = journal->spareCapacity;
+            journal->pendingCount = 0;
+            journal->flushing = 1;
+            pthread_mutex_unlock(&journal->lock);
+
+            written = fwrite(batch, sizeof(*batch), (size_t)count, journal->fp) == (size_t)count &&
+                      syncFile(journal->fp);
+
+            pthread_mutex_lock(&journal->lock);
+            journal->flushing = 0;
+            if (written)
+            {
+                journal->durableLsn = batch[count - 1].lsn;
+                journal->fileSize += (long)((size_t)count * sizeof(*batch));
+            }
+            else
+                journal->failed = 1;
+            journal->spare = batch;
+            journal->spareCapacity = capacity;
+            pthread_cond_broadcast(&journal->done);
+        }
+    }
+    pthread_mutex_unlock(&journal->lock);
+
+    return NULL;
+}
+
+// Wait until every queued record is on disk (lock held)
+static void waitForFlush(struct Journal* journal)
+{
+    while (journal->flushing || journal->pendingCount > 0)
+        pthread_cond_wait(&journal->done, &journal->lock);
+}
+
+// Compactor thread: write the copied store as the new snapshot
+static void* runCompactor(void* arg)
+{
+    struct Journal* journal = arg;
+
+    // Startup checks only the header, so the snapshot is read back whole before the journal is trimmed
+    int saved = saveSnapshot(journal->snapshotFile, &journal->compactCopy) &&
+                verifySnapshot(journal->snapshotFile);
+
+    pthread_mutex_lock(&journal->lock);
+    journal->compactSaved = saved;
+    journal->compactDone = 1;
+    pthread_mutex_unlock(&journal->lock);
+
+    return NULL;
+}
+
+// Trim the journal once a background compaction has written its snapshot
+static void finishCompaction(struct Journal* journal, int block)
+{
+    int done = 0;
+
+    if (!journal->compacting)
+        return;
+
+    pthread_mutex_lock(&journal->lock);
+    done = journal->compactDone;
+    pthread_mutex_unlock(&journal->lock);
+    if (!done && !block)
+        return;
+
+    pthread_join(journal->compactor, NULL);
+    storeFree(&journal->compactCopy);
+    journal->compacting = 0;
+
+    if (journal->compactSaved)
+    {
+        pthread_mutex_lock(&journal->lock);
+        waitForFlush(journal);
+        trimJournal(journal, journal->compactOffset);
+        pthread_mutex_unlock(&journal->lock);
+    }
+    else
+        fprintf(stderr, "ERROR: Could not write %s\n", journal->snapshotFile);
+}
+#endif
+
+// Queue a record and, unless syncs are deferred, wait until it is on disk (returns 1 on success, 0 on failure)
+static int appendRecord(struct ClinicData* data, struct JournalRecord* record)
+{
+    struct Journal* journal = data->journal;
+    int committed = 0, compact = 0;
+
+    // A store without a journal (a copy) keeps its changes in memory only
+    if (journal == NULL)
+        return 1;
+
+#ifndef _WIN32
+    finishCompaction(journal, 0);
+
+    pthread_mutex_lock(&journal->lock);
+    if (!journal->failed &&
+        growArray((void**)&journal->pending, &journal->pendingCapacity,
+                  journal->pendingCount + 1, sizeof(struct JournalRecord)))
+    {
+        record->lsn = ++data->lastLsn;
+        record->checksum = checksumRecord(record);
+        journal->pending[journal->pendingCount++] = *record;
+        pthread_cond_signal(&journal->wake);
+
+        while (!journal->deferSync && journal->durableLsn < record->lsn && !journal->failed)
+            pthread_cond_wait(&journal->done, &journal->lock);
+        committed = journal->deferSync || journal->durableLsn >= record->lsn;
+    }
+    if (!committed)
+    {
+        journal->failed = 1;
+        reportJournalFailure(journal);
+    }
+    compact = committed && journal->fileSize > JOURNAL_COMPACT_SIZE && !journal->compacting;
+    pthread_mutex_unlock(&journal->lock);
+#else
+    if (!journal->failed)
+    {
+        record->lsn = ++data->lastLsn;
+        record->checksum = checksumRecord(record);
+        committed = fwrite(record, sizeof(*record), 1, journal->fp) == 1 &&
+                    (journal->deferSync || syncFile(journal->fp));
+    }
+    if (committed)
+        journal->fileSize += (long)sizeof(*record);
+    else
+    {
+        journal->failed = 1;
+        reportJournalFailure(journal);
+    }
+    compact = committed && journal->fileSize > JOURNAL_COMPACT_SIZE;
+#endif
+
+    if (compact)
+        journalCompact(data);
+
+    return committed;
+}
+
+
+//////////////////////////////////////
+// JOURNAL FUNCTIONS
+//////////////////////////////////////
+
+// Check if a journal file holds any change records
+int journalHasRecords(const char* journalFile)
+{
+    FILE* fp = fopen(journalFile, "rb");
+    long length = 0;
+
+    if (fp == NULL)
+        return 0;
+
+    if (fseek(fp, 0, SEEK_END) == 0)
+        length = ftell(fp);
+    fclose(fp);
+
+    // Anything past the header counts, even a record cut short or from another version
+    return length > (long)sizeof(struct JournalHeader);
+}
+
+// Replay a journal over the clinic data and open it for appending (returns NULL on failure)
+struct Journal* journalOpen(const char* journalFile, const char* snapshotFile,
+                            struct ClinicData* data, int* replayed)
+{
+    struct Journal* journal = NULL;
+    struct LoadedFile file = { 0 };
+    const char* records = NULL;
+    long validLength = (long)sizeof(struct JournalHeader);
+
+    *replayed = 0;
+
+    if (strlen(journalFile) + 5 > FILENAME_MAX || strlen(snapshotFile) + 1 > FILENAME_MAX)
+        return NULL;
+
+    if (loadFile(journalFile, &file))
+    {
+        if (!isJournalHeaderValid(file.text, file.length))
+        {
+            fprintf(stderr, "ERROR: %s is not a journal this version can read\n", journalFile);
+            freeLoadedFile(&file);
+            return NULL;
+        }
+        validLength = replayJournal(journalFile, file.text, file.length, data, replayed);
+        records = file.text + sizeof(struct JournalHeader);
+    }
+
+    // Start a new journal, or cut off the damaged tail so appends follow good records
+    if (validLength != file.length &&
+        !writeJournalFile(journalFile, records, validLength - (long)sizeof(struct JournalHeader)))
+    {
+        fprintf(stderr, "ERROR: Could not write %s\n", journalFile);
+        freeLoadedFile(&file);
+        return NULL;
+    }
+    freeLoadedFile(&file);
+
+    journal = calloc(1, sizeof(*journal));
+    if (journal == NULL)
+        return NULL;
+
+    strcpy(journal->journalFile, journalFile);
+    strcpy(journal->snapshotFile, snapshotFile);
+    journal->fileSize = validLength;
+    journal->fp = fopen(journalFile, "ab");
+
+#ifndef _WIN32
+    journal->durableLsn = data->lastLsn;
+    if (journal->fp != NULL)
+    {
+        pthread_mutex_init(&journal->lock, NULL);
+        pthread_cond_init(&journal->wake, NULL);
+        pthread_cond_init(&journal->done, NULL);
+        if (pthread_create(&journal->flusher, NULL, runFlusher, journal) != 0)
+        {
+            pthread_mutex_destroy(&journal->lock);
+            pthread_cond_destroy(&journal->wake);
+            pthread_cond_destroy(&journal->done);
+            fclose(journal->fp);
+            journal->fp = NULL;
+        }
+    }
+#endif
+
+    if (journal->fp == NULL)
+    {
+        free(journal);
+        return NULL;
+    }
+
+    return journal;
+}
+
+// Flush and close the journal, finishing any compaction still running
+void journalClose(struct ClinicData* data)
+{
+    struct Journal* journal = data->journal;
+
+    if (journal == NULL)
+        return;
+
+#ifndef _WIN32
+    finishCompaction(journal, 1);
+
+    pthread_mutex_lock(&journal->lock);
+    journal->stopping = 1;
+    pthread_cond_signal(&journal->wake);
+    pthread_mutex_unlock(&journal->lock);
+    pthread_join(journal->flusher, NULL);
+
+    pthread_mutex_destroy(&journal->lock);
+    pthread_cond_destroy(&journal->wake);
+    pthread_cond_destroy(&journal->done);
+    free(journal->spare);
+#endif
+
+    if (journal->fp != NULL)
+        fclose(journal->fp);
+    free(journal->pending);
+    free(journal);
+    data->journal = NULL;
+}
+
+// Record a patient change in 'slot' and wait until it is on disk (returns 1 on success or if the store
+// has no journal, 0 on failure; once a write fails, every later change fails too)
+int journalLogPatient(struct ClinicData* data, int type, int slot, const struct Patient* patient)
+{
+    struct JournalRecord record;
+
+    // Cleared first so padding bytes checksum the same on replay
+    memset(&record, 0, sizeof(record));
+    record.type = type;
+    record.slot = slot;
+    record.item.patient = *patient;
+
+    return appendRecord(data, &record);
+}
+
+// Record an appointment change and wait until it is on disk (returns 1 on success or if the store
+// has no journal, 0 on failure)
+int journalLogAppointment(struct ClinicData* data, int type, const struct Appointment* appoint)
+{
+    struct JournalRecord record;
+
+    memset(&record, 0, sizeof(record));
+    record.type = type;
+    record.slot = -1;
+    record.item.appoint = *appoint;
+
+    return appendRecord(data, &record);
+}
+
+// Let changes return once queued instead of once on disk (acknowledge them after journalSync)
+void journalDeferSync(struct ClinicData* data, int defer)
+{
+    if (data->journal != NULL)
+        data->journal->deferSync = defer;
+}
+
+// Wait until every queued change is on disk (returns 1 on success, 0 on failure)
+int journalSync(struct ClinicData* data)
+{
+    return journalSyncTo(data, data->lastLsn);
+}
+
+// Wait until the changes up to journal record 'lsn' are on disk (returns 1 on success, 0 on failure)
+int journalSyncTo(struct ClinicData* data, unsigned long long lsn)
+{
+    struct Journal* journal = data->journal;
+    int synced = 0;
+
+    if (journal == NULL)
+        return 0;
+
+#ifndef _WIN32
+    pthread_mutex_lock(&journal->lock);
+    while (journal->durableLsn < lsn && !journal->failed)
+        pthread_cond_wait(&journal->done, &journal->lock);
+    synced = journal->durableLsn >= lsn;
+    if (!synced)
+        reportJournalFailure(journal);
+    pthread_mutex_unlock(&journal->lock);
+#else
+    synced = !journal->failed && syncFile(journal->fp);
+    if (!synced)
+    {
+        journal->failed = 1;
+        reportJournalFailure(journal);
+    }
+#endif
+
+    return synced;
+}
+
+// Start writing a new snapshot in the background and trim the journal when it is done (returns 1 if started)
+int journalCompact(struct ClinicData* data)
+{
+    struct Journal* journal = data->journal;
+    int started = 0;
+
+    if (journal == NULL)
+        return 0;
+
+#ifndef _WIN32
+    if (journal->compacting)
+        return 0;
+
+    // The copy holds the store exactly as of the last durable record, so the
+    // snapshot covers the journal up to here and changes can go on meanwhile
+    pthread_mutex_lock(&journal->lock);
+    waitForFlush(journal);
+
+    if (!journal->failed && storeCopy(&journal->compactCopy, data))
+    {
+        journal->compactDone = 0;
+        journal->compactOffset = journal->fileSize;
+        if (pthread_create(&journal->compactor, NULL, runCompactor, journal) == 0)
+            journal->compacting = started = 1;
+        else
+            storeFree(&journal->compactCopy);
+    }
+    pthread_mutex_unlock(&journal->lock);
+#else
+    // No compactor thread here: write the snapshot in the foreground instead
+    if (!journal->failed && saveSnapshot(journal->snapshotFile, data) &&
+        verifySnapshot(journal->snapshotFile))
+        started = trimJournal(journal, journal->fileSize);
+    else
+        fprintf(stderr, "ERROR: Could not write %s\n", journal->snapshotFile);
+#endif
+
+    return started;
+}
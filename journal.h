@@ -0,0 +1,61 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+// Journal file written next to the snapshot
+#define JOURNAL_FILE "clinicData.jnl"
+
+// Journal format version (bump whenever a journal record changes)
+#define JOURNAL_VERSION 3
+
+// Compact the journal into a new snapshot once it grows past this many bytes
+#define JOURNAL_COMPACT_SIZE (1024L * 1024L)
+
+// Journal record types
+#define JOURNAL_ADD_PATIENT 1
+#define JOURNAL_EDIT_PATIENT 2
+#define JOURNAL_REMOVE_PATIENT 3
+#define JOURNAL_ADD_APPOINTMENT 4
+#define JOURNAL_REMOVE_APPOINTMENT 5
+
+struct ClinicData;
+struct Patient;
+struct Appointment;
+
+// Data type: Journal (open journal file and its group-commit writer, see journal.c)
+struct Journal;
+
+//////////////////////////////////////
+// JOURNAL FUNCTIONS
+//////////////////////////////////////
+
+// Check if a journal file holds any change records
+int journalHasRecords(const char* journalFile);
+
+// Replay a journal over the clinic data and open it for appending (returns NULL on failure)
+struct Journal* journalOpen(const char* journalFile, const char* snapshotFile,
+                            struct ClinicData* data, int* replayed);
+
+// Flush and close the journal, finishing any compaction still running
+void journalClose(struct ClinicData* data);
+
+// Record a patient change in 'slot' and wait until it is on disk (returns 1 on success or if the store
+// has no journal, 0 on failure; once a write fails, every later change fails too)
+int journalLogPatient(struct ClinicData* data, int type, int slot, const struct Patient* patient);
+
+// Record an appointment change and wait until it is on disk (returns 1 on success or if the store
+// has no journal, 0 on failure)
+int journalLogAppointment(struct ClinicData* data, int type, const struct Appointment* appoint);
+
+// Let changes return once queued instead of once on disk (acknowledge them after journalSync)
+void journalDeferSync(struct ClinicData* data, int defer);
+
+// Wait until every queued change is on disk (returns 1 on success, 0 on failure)
+int journalSync(struct ClinicData* data);
+
+// Wait until the changes up to journal record 'lsn' are on disk (returns 1 on success, 0 on failure)
+int journalSyncTo(struct ClinicData* data, unsigned long long lsn);
+
+// Start writing a new snapshot in the background and trim the journal when it is done (returns 1 if started)
+int journalCompact(struct ClinicData* data);
+
+#endif // !JOURNAL_H
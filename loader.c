@@ -0,0 +1,427 @@
+/*
+Loader module
+- File buffer functions: read a data file in one pass and walk its lines
+- Parse functions: hand-rolled field scanners for the patient and
+  appointment data formats, with per-line error reporting
+- Chunked parse functions: split a file at line breaks and parse the
+  chunks on worker threads into chunk-local buffers, so the caller can
+  merge them in file order
+*/
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#include "loader.h"
+#include "store.h"
+
+
+//////////////////////////////////////
+// FIELD SCANNER FUNCTIONS
+//////////////////////////////////////
+
+// Scan an unsigned decimal integer (returns 1 on success, 0 if missing or too large)
+int scanInt(const char** cursor, const char* end, int* value)
+{
+    const char* cur = *cursor;
+    int result = 0;
+
+    if (cur == end || *cur < '0' || *cur > '9')
+        return 0;
+
+    while (cur < end && *cur >= '0' && *cur <= '9')
+    {
+        if (result > (INT_MAX - (*cur - '0')) / 10)
+            return 0;
+        result = result * 10 + (*cur - '0');
+        cur++;
+    }
+
+    *value = result;
+    *cursor = cur;
+
+    return 1;
+}
+
+// Copy text up to a delimiter or the end of line (returns its length, -1 if longer than maxLen)
+static int scanText(const char** cursor, const char* end, char delimiter,
+                    char* text, int maxLen)
+{
+    const char* cur = *cursor;
+    const char* stop = memchr(cur, delimiter, (size_t)(end - cur));
+    int length = 0;
+
+    if (stop == NULL)
+        stop = end;
+
+    length = (int)(stop - cur);
+    if (length > maxLen)
+        return -1;
+
+    memcpy(text, cur, (size_t)length);
+    text[length] = '\0';
+    *cursor = stop;
+
+    return length;
+}
+
+// Consume one expected character (returns 1 if it was there)
+int expectChar(const char** cursor, const char* end, char expected)
+{
+    if (*cursor == end || **cursor != expected)
+        return 0;
+
+    (*cursor)++;
+
+    return 1;
+}
+
+
+//////////////////////////////////////
+// FILE BUFFER FUNCTIONS
+//////////////////////////////////////
+
+// Read a whole data file into memory (returns 1 on success, 0 on failure)
+int loadFile(const char* datafile, struct LoadedFile* file)
+{
+    FILE* fp = NULL;
+    long length = 0;
+    int loaded = 0;
+
+    file->text = NULL;
+    file->length = 0;
+
+    fp = fopen(datafile, "rb");
+    if (fp != NULL)
+    {
+        if (fseek(fp, 0, SEEK_END) == 0 && (length = ftell(fp)) >= 0 &&
+            fseek(fp, 0, SEEK_SET) == 0)
+        {
+            file->text = malloc((size_t)length + 1);
+            if (file->text != NULL &&
+                fread(file->text, 1, (size_t)length, fp) == (size_t)length)
+            {
+                file->text[length] = '\0';
+                file->length = length;
+                loaded = 1;
+            }
+        }
+        fclose(fp);
+    }
+
+    if (!loaded)
+        freeLoadedFile(file);
+
+    return loaded;
+}
+
+// Release the memory held by a loaded file
+void freeLoadedFile(struct LoadedFile* file)
+{
+    free(file->text);
+    file->text = NULL;
+    file->length = 0;
+}
+
+// Count the lines in a buffer (a last line without a newline counts)
+int countLines(const char* text, const char* end)
+{
+    int lines = 0;
+    const char* cur = text;
+
+    while (cur < end && (cur = memchr(cur, '\n', (size_t)(end - cur))) != NULL)
+    {
+        lines++;
+        cur++;
+    }
+
+    if (end > text && end[-1] != '\n')
+        lines++;
+
+    return lines;
+}
+
+// Get the next line from a buffer and advance the cursor (returns NULL at the end)
+const char* nextLine(const char** cursor, const char* end, const char** lineEnd)
+{
+    const char* line = *cursor;
+    const char* newLine = NULL;
+
+    if (line >= end)
+        return NULL;
+
+    newLine = memchr(line, '\n', (size_t)(end - line));
+    if (newLine == NULL)
+        newLine = end;
+
+    *cursor = newLine < end ? newLine + 1 : end;
+
+    // Accept files saved with CRLF line endings
+    if (newLine > line && newLine[-1] == '\r')
+        newLine--;
+    *lineEnd = newLine;
+
+    return line;
+}
+
+
+//////////////////////////////////////
+// PARSE FUNCTIONS
+//////////////////////////////////////
+
+// Parse a "number|name|description|phone" line (returns NULL on success or an error message)
+const char* parsePatientLine(const char* line, const char* lineEnd, struct Patient* patient)
+{
+    struct Patient record = { 0 };
+    const char* cur = line;
+    const char* error = NULL;
+
+    if (!scanInt(&cur, lineEnd, &record.patientNumber) || record.patientNumber == 0)
+        return "invalid patient number";
+    if (!expectChar(&cur, lineEnd, '|'))
+        return "expected '|' after the patient number";
+
+    error = parsePatientFields(cur, lineEnd, &record);
+    if (error == NULL)
+        *patient = record;
+
+    return error;
+}
+
+// Parse "name|description|phone" fields into a patient, keeping its number (returns NULL on success or an error message)
+const char* parsePatientFields(const char* fields, const char* lineEnd, struct Patient* patient)
+{
+    struct Patient record = *patient;
+    struct Phone phone = { 0 };
+    const char* cur = fields;
+    int length = 0;
+
+    if (scanText(&cur, lineEnd, '|', record.name, NAME_LEN) < 1)
+        return "patient name must be 1 to 15 characters";
+    if (!expectChar(&cur, lineEnd, '|'))
+        return "expected '|' after the patient name";
+
+    if (scanText(&cur, lineEnd, '|', phone.description, PHONE_DESC_LEN) < 0 ||
+        phoneTypeFromName(phone.description) == -1)
+        return "phone description must be CELL, HOME, WORK or TBD";
+    if (!expectChar(&cur, lineEnd, '|'))
+        return "expected '|' after the phone description";
+
+    length = scanText(&cur, lineEnd, '|', phone.number, PHONE_LEN);
+    if (length < 0 || (length > 0 && phoneKeyFromString(phone.number) == 0))
+        return "phone number must be empty or 10 digits";
+    if (cur != lineEnd)
+        return "unexpected text after the phone number";
+
+    // Both phone fields were checked above, so packing cannot fail
+    packPhone(&record, &phone);
+    *patient = record;
+
+    return NULL;
+}
+
+// Parse a "patient,year,month,day,hour,min[,room,minutes]" line (returns NULL on success or an error message)
+const char* parseAppointmentLine(const char* line, const char* lineEnd, struct Appointment* appoint)
+{
+    struct Date date = { 0 };
+    struct Time time = { 0 };
+    const char* cur = line;
+    int patientNumber = 0, room = 1, minutes = APPOINTMENT_INTERVAL;
+
+    if (!scanInt(&cur, lineEnd, &patientNumber) || patientNumber == 0 ||
+        !expectChar(&cur, lineEnd, ',') ||
+        !scanInt(&cur, lineEnd, &date.year) || !expectChar(&cur, lineEnd, ',') ||
+        !scanInt(&cur, lineEnd, &date.month) || !expectChar(&cur, lineEnd, ',') ||
+        !scanInt(&cur, lineEnd, &date.day) || !expectChar(&cur, lineEnd, ',') ||
+        !scanInt(&cur, lineEnd, &time.hour) || !expectChar(&cur, lineEnd, ',') ||
+        !scanInt(&cur, lineEnd, &time.min))
+        return "expected 6 comma-separated whole numbers";
+
+    // Visits without a room and length are one timeslot in room 1
+    if (cur != lineEnd && (!expectChar(&cur, lineEnd, ',') ||
+                           !scanInt(&cur, lineEnd, &room) || !expectChar(&cur, lineEnd, ',') ||
+                           !scanInt(&cur, lineEnd, &minutes)))
+        return "expected the room and minutes after the appointment minute";
+    if (cur != lineEnd)
+        return "unexpected text after the appointment length";
+
+    if (dayKeyFromDate(date.year, date.month, date.day) == 0)
+        return "invalid appointment date";
+    if (time.hour > 23 || time.min > 59)
+        return "invalid appointment time";
+    if (!packAppointment(appoint, patientNumber, &date, &time))
+        return "appointment year is out of range";
+    if (!packVisit(appoint, room, minutes))
+        return "invalid appointment room or length";
+
+    return NULL;
+}
+
+// Report a data file line that could not be imported
+void reportLoadError(const char* datafile, int lineNumber, const char* message)
+{
+    fprintf(stderr, "ERROR: %s line %d: %s\n", datafile, lineNumber, message);
+}
+
+
+//////////////////////////////////////
+// CHUNKED PARSE FUNCTIONS
+//////////////////////////////////////
+
+// Parse one line into a record of the chunk's type (returns NULL on success or an error message)
+static const char* parseChunkLine(const struct LoadChunk* chunk, const char* line,
+                                  const char* lineEnd, void* record)
+{
+    return chunk->recordType == LOAD_PATIENTS ?
+           parsePatientLine(line, lineEnd, record) :
+           parseAppointmentLine(line, lineEnd, record);
+}
+
+// Parse every line of a chunk into its own record and error buffers
+static void parseChunk(struct LoadChunk* chunk)
+{
+    size_t recordSize = chunk->recordType == LOAD_PATIENTS ?
+                        sizeof(struct Patient) : sizeof(struct Appointment);
+    const char* cursor = chunk->start;
+    const char* line = NULL;
+    const char* lineEnd = NULL;
+    const char* error = NULL;
+    char* record = NULL;
+
+    chunk->isFull = !growArray(&chunk->records, &chunk->recordCapacity,
+                               countLines(chunk->start, chunk->end), recordSize);
+
+    while (!chunk->isFull && (line = nextLine(&cursor, chunk->end, &lineEnd)) != NULL)
+    {
+        chunk->lineCount++;
+        if (line == lineEnd)
+            continue;
+
+        record = (char*)chunk->records + (size_t)chunk->recordCount * recordSize;
+        error = parseChunkLine(chunk, line, lineEnd, record);
+        if (error == NULL)
+            chunk->recordCount++;
+        else if (growArray((void**)&chunk->errors, &chunk->errorCapacity,
+                           chunk->errorCount + 1, sizeof(struct LoadError)))
+        {
+            chunk->errors[chunk->errorCount].lineNumber = chunk->lineCount;
+            chunk->errors[chunk->errorCount].message = error;
+            chunk->errorCount++;
+        }
+        else
+            chunk->isFull = 1;
+    }
+}
+
+#ifndef _WIN32
+// Worker thread: parse one chunk
+static void* runChunkParser(void* arg)
+{
+    parseChunk(arg);
+
+    return NULL;
+}
+#endif
+
+// Pick how many chunks to split a file into (one per core, none smaller than LOAD_MIN_CHUNK_SIZE)
+static int chunkCountFor(long length)
+{
+    long count = 1;
+
+#ifndef _WIN32
+    count = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (count > length / LOAD_MIN_CHUNK_SIZE)
+        count = length / LOAD_MIN_CHUNK_SIZE;
+    if (count > LOAD_MAX_CHUNKS)
+        count = LOAD_MAX_CHUNKS;
+
+    return count > 1 ? (int)count : 1;
+}
+
+// Split a file into newline-aligned chunks and parse them in parallel (returns # of chunks)
+int parseFileChunks(const struct LoadedFile* file, int recordType, struct LoadChunk** chunks)
+{
+    const char* end = file->text + file->length;
+    const char* cut = file->text;
+    int count = chunkCountFor(file->length), i = 0;
+#ifndef _WIN32
+    pthread_t threads[LOAD_MAX_CHUNKS];
+    int started[LOAD_MAX_CHUNKS] = { 0 };
+#endif
+
+    *chunks = calloc((size_t)count, sizeof(struct LoadChunk));
+    if (*chunks == NULL)
+        return 0;
+
+    // Cut after the first newline past each even share so no line is split
+    for (i = 0; i < count; i++)
+    {
+        (*chunks)[i].start = cut;
+        (*chunks)[i].recordType = recordType;
+        if (i < count - 1)
+        {
+            cut = file->text + file->length / count * (i + 1);
+            if (cut < (*chunks)[i].start)
+                cut = (*chunks)[i].start;
+            cut = memchr(cut, '\n', (size_t)(end - cut));
+            cut = cut != NULL ? cut + 1 : end;
+        }
+        else
+            cut = end;
+        (*chunks)[i].end = cut;
+    }
+
+#ifndef _WIN32
+    // The calling thread parses the first chunk itself
+    for (i = 1; i < count; i++)
+        started[i] = pthread_create(&threads[i], NULL, runChunkParser, &(*chunks)[i]) == 0;
+
+    parseChunk(&(*chunks)[0]);
+
+    for (i = 1; i < count; i++)
+    {
+        if (started[i])
+            pthread_join(threads[i], NULL);
+        else
+            parseChunk(&(*chunks)[i]);
+    }
+#else
+    for (i = 0; i < count; i++)
+        parseChunk(&(*chunks)[i]);
+#endif
+
+    return count;
+}
+
+// Report the errors of a parsed chunk with file-wide line numbers (returns the chunk's line count)
+int reportChunkErrors(const char* datafile, int firstLine, const struct LoadChunk* chunk)
+{
+    int i = 0;
+
+    for (i = 0; i < chunk->errorCount; i++)
+        reportLoadError(datafile, firstLine + chunk->errors[i].lineNumber, chunk->errors[i].message);
+
+    return chunk->lineCount;
+}
+
+// Release the chunks returned by parseFileChunks
+void freeFileChunks(struct LoadChunk* chunks, int count)
+{
+    int i = 0;
+
+    for (i = 0; i < count; i++)
+    {
+        free(chunks[i].records);
+        free(chunks[i].errors);
+    }
+    free(chunks);
+}
@@ -0,0 +1,108 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include "clinic.h"
+
+// Record types parsed by the chunked loader
+#define LOAD_PATIENTS 1
+#define LOAD_APPOINTMENTS 2
+
+// Files smaller than this per extra thread are parsed on fewer threads
+#define LOAD_MIN_CHUNK_SIZE (256L * 1024L)
+
+// Most chunks (and worker threads) a file is split into
+#define LOAD_MAX_CHUNKS 64
+
+//////////////////////////////////////
+// Structures
+//////////////////////////////////////
+
+// Data type: Loaded File (whole file contents read in one pass)
+struct LoadedFile
+{
+    char* text;
+    long length;
+};
+
+// Data type: Load Error (a line that failed to parse, reported after the merge)
+struct LoadError
+{
+    int lineNumber;
+    const char* message;
+};
+
+// Data type: Load Chunk (one newline-aligned slice of a file and the records parsed from it)
+struct LoadChunk
+{
+    const char* start;
+    const char* end;
+    int recordType;
+    int lineCount;
+    void* records;
+    int recordCount;
+    int recordCapacity;
+    struct LoadError* errors;
+    int errorCount;
+    int errorCapacity;
+    int isFull;
+};
+
+//////////////////////////////////////
+// FIELD SCANNER FUNCTIONS
+//////////////////////////////////////
+
+// Scan an unsigned decimal integer (returns 1 on success, 0 if missing or too large)
+int scanInt(const char** cursor, const char* end, int* value);
+
+// Consume one expected character (returns 1 if it was there)
+int expectChar(const char** cursor, const char* end, char expected);
+
+
+//////////////////////////////////////
+// FILE BUFFER FUNCTIONS
+//////////////////////////////////////
+
+// Read a whole data file into memory (returns 1 on success, 0 on failure)
+int loadFile(const char* datafile, struct LoadedFile* file);
+
+// Release the memory held by a loaded file
+void freeLoadedFile(struct LoadedFile* file);
+
+// Count the lines in a buffer (a last line without a newline counts)
+int countLines(const char* text, const char* end);
+
+// Get the next line from a buffer and advance the cursor (returns NULL at the end)
+const char* nextLine(const char** cursor, const char* end, const char** lineEnd);
+
+
+//////////////////////////////////////
+// PARSE FUNCTIONS
+//////////////////////////////////////
+
+// Parse a "number|name|description|phone" line (returns NULL on success or an error message)
+const char* parsePatientLine(const char* line, const char* lineEnd, struct Patient* patient);
+
+// Parse "name|description|phone" fields into a patient, keeping its number (returns NULL on success or an error message)
+const char* parsePatientFields(const char* fields, const char* lineEnd, struct Patient* patient);
+
+// Parse a "patient,year,month,day,hour,min[,room,minutes]" line (returns NULL on success or an error message)
+const char* parseAppointmentLine(const char* line, const char* lineEnd, struct Appointment* appoint);
+
+// Report a data file line that could not be imported
+void reportLoadError(const char* datafile, int lineNumber, const char* message);
+
+
+//////////////////////////////////////
+// CHUNKED PARSE FUNCTIONS
+//////////////////////////////////////
+
+// Split a file into newline-aligned chunks and parse them in parallel (returns # of chunks)
+int parseFileChunks(const struct LoadedFile* file, int recordType, struct LoadChunk** chunks);
+
+// Report the errors of a parsed chunk with file-wide line numbers (returns the chunk's line count)
+int reportChunkErrors(const char* datafile, int firstLine, const struct LoadChunk* chunk);
+
+// Release the chunks returned by parseFileChunks
+void freeFileChunks(struct LoadChunk* chunks, int count);
+
+#endif // !LOADER_H
@@ -1,34 +1,175 @@
 /*
 Veterinary Clinic Application
 Main module
-- Declares and populates main structs:
-    - pets: array of Patient with the patient data.
-    - appoints: array of appointments with the appointment data.
-    - data: data structure that contains pets, MAX_PETS, appoints, and MAX_APPPOINTMENTS.
-- Calls menuMain that controls the execution of the application.
+- Declares and populates the main data structure:
+    - data: ClinicData store with growable patient and appointment arrays.
+    - Loaded from the binary snapshot when it is newer than the text data
+      files, otherwise imported from the text files (and snapshotted).
+    - Changes since the snapshot are replayed from the journal, which then
+      records every change made in this session. A journal holding
+      changes is never dropped for a text import: without a usable
+      snapshot the program stops instead.
+- Calls menuMain that controls the execution of the application, or
+  with "--batch [file]" runs the batch commands in the file (or stdin)
+  instead of the menus, or with "--serve [socket]" serves them to local
+  clients until stopped.
+- With "--client [socket] [connections]" it loads nothing and sends the
+  batch commands on stdin to a running server instead.
+- With "--generate <patients> <appointments> [seed]" it writes synthetic
+  data files, and with "--bench [operations]" it times the clinic
+  operations on the data files (neither uses the snapshot or journal).
+- With "--verify" it checks the whole snapshot against its checksum.
+- With CLINIC_STATS_FILE set, the operation statistics gathered during
+  the session are written to that file at exit.
 */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
+#include "batch.h"
+#include "bench.h"
+#include "client.h"
 #include "clinic.h"
+#include "server.h"
+#include "snapshot.h"
+#include "stats.h"
+#include "store.h"
 
 // Constants
-#define MAX_PETS 20
-#define MAX_APPOINTMENTS 50
+#define PATIENT_FILE "patientData.txt"
+#define APPOINTMENT_FILE "appointmentData.txt"
 
-int main(void)
+// Free what was set up for a session that cannot start (returns the exit status)
+static int stopSession(struct ClinicData* data, FILE* batchInput)
 {
-    struct Patient pets[MAX_PETS] = { {0} };
-    struct Appointment appoints[MAX_APPOINTMENTS] = { {0} };
-    struct ClinicData data = { pets, MAX_PETS, appoints, MAX_APPOINTMENTS };
+    if (batchInput != stdin)
+        fclose(batchInput);
+    storeFree(data);
 
-    int patientCount = importPatients("patientData.txt", pets, MAX_PETS);
-    int appointmentCount = importAppointments("appointmentData.txt", appoints, MAX_APPOINTMENTS);
+    return 1;
+}
 
-    printf("Imported %d patient records...\n", patientCount);
-    printf("Imported %d appointment records...\n\n", appointmentCount);
+int main(int argc, char* argv[])
+{
+    struct ClinicData data;
+    int patientCount = 0, appointmentCount = 0, replayed = 0, status = 0, isSnapshotLoaded = 0;
+    int isBatch = argc > 1 && strcmp(argv[1], "--batch") == 0;
+    int isServer = argc > 1 && strcmp(argv[1], "--serve") == 0;
+    const char* socketPath = argc > 2 ? argv[2] : SERVER_SOCKET;
+    const char* statsFile = getenv(STATS_FILE_VARIABLE);
+    FILE* batchInput = stdin;
+
+    // These modes load the data files themselves (or not at all), so they run before anything is loaded
+    if (argc > 1 && strcmp(argv[1], "--client") == 0)
+        return runClient(stdin, socketPath, argc > 3 ? atoi(argv[3]) : 1) >= 0 ? 0 : 1;
+
+    if (argc > 1 && strcmp(argv[1], "--generate") == 0)
+    {
+        if (argc < 4)
+        {
+            fprintf(stderr, "ERROR: Usage: --generate <patients> <appointments> [seed]\n");
+            return 1;
+        }
+        return generateClinicData(PATIENT_FILE, APPOINTMENT_FILE, atoi(argv[2]), atoi(argv[3]),
+                                  argc > 4 ? (unsigned int)strtoul(argv[4], NULL, 10) : 1u) ? 0 : 1;
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+        return runBenchmark(PATIENT_FILE, APPOINTMENT_FILE,
+                            argc > 2 ? atoi(argv[2]) : BENCH_OPERATIONS) ? 0 : 1;
+    if (argc > 1 && strcmp(argv[1], "--verify") == 0)
+    {
+        if (verifySnapshot(SNAPSHOT_FILE))
+            return 0;
+        fprintf(stderr, "ERROR: %s is damaged or from another version\n", SNAPSHOT_FILE);
+        return 1;
+    }
+
+    if (isBatch && argc > 2 && strcmp(argv[2], "-") != 0)
+    {
+        batchInput = fopen(argv[2], "r");
+        if (batchInput == NULL)
+        {
+            fprintf(stderr, "ERROR: Could not open %s\n", argv[2]);
+            return 1;
+        }
+    }
+
+    storeInit(&data);
+
+    if (isSnapshotCurrent(SNAPSHOT_FILE, PATIENT_FILE, APPOINTMENT_FILE))
+    {
+        isSnapshotLoaded = loadSnapshot(SNAPSHOT_FILE, &data);
+        if (!isSnapshotLoaded)
+            fprintf(stderr, "ERROR: %s is damaged or from another version\n", SNAPSHOT_FILE);
+    }
+
+    // Changes are never written back to the data files, so importing them would drop the journal's
+    if (!isSnapshotLoaded && journalHasRecords(JOURNAL_FILE))
+    {
+        fprintf(stderr, "ERROR: %s holds changes that need %s (restore the snapshot, or move the "
+                        "journal away to import the data files)\n", JOURNAL_FILE, SNAPSHOT_FILE);
+        return stopSession(&data, batchInput);
+    }
+
+    if (isSnapshotLoaded)
+    {
+        if (!isBatch && !isServer)
+        {
+            printf("Loaded %d patient records from snapshot...\n", data.patientCount);
+            printf("Loaded %d appointment records from snapshot...\n\n", data.appointmentCount);
+        }
+    }
+    else
+    {
+        patientCount = importPatients(PATIENT_FILE, &data);
+        appointmentCount = importAppointments(APPOINTMENT_FILE, &data);
+
+        if (!isBatch && !isServer)
+        {
+            printf("Imported %d patient records...\n", patientCount);
+            printf("Imported %d appointment records...\n\n", appointmentCount);
+        }
+
+        // The journal holds no records, only a header the imported data may not match
+        remove(JOURNAL_FILE);
+        if (!saveSnapshot(SNAPSHOT_FILE, &data))
+        {
+            fprintf(stderr, "ERROR: Could not write %s\n", SNAPSHOT_FILE);
+            return stopSession(&data, batchInput);
+        }
+    }
+
+    // Changes cannot be kept without the journal, so the session does not start
+    data.journal = journalOpen(JOURNAL_FILE, SNAPSHOT_FILE, &data, &replayed);
+    if (data.journal == NULL)
+    {
+        fprintf(stderr, "ERROR: Could not open %s\n", JOURNAL_FILE);
+        return stopSession(&data, batchInput);
+    }
+    if (replayed > 0)
+    {
+        if (!isBatch && !isServer)
+            printf("Replayed %d journal records...\n\n", replayed);
+        journalCompact(&data);
+    }
+
+    if (isBatch)
+    {
+        status = runBatch(batchInput, &data) >= 0 ? 0 : 1;
+        if (batchInput != stdin)
+            fclose(batchInput);
+    }
+    else if (isServer)
+        status = runServer(socketPath, &data) ? 0 : 1;
+    else
+        menuMain(&data);
+
+    journalClose(&data);
+    storeFree(&data);
 
-    menuMain(&data);
+    if (statsFile != NULL)
+        statsDump(statsFile);
     
-    return 0;
+    return status;
 }
\ No newline at end of file
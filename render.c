@@ -0,0 +1,209 @@
+/*
+Render module
+- Render functions: format text, padded fields and zero-padded
+  integers into a buffer by hand, then write the whole buffer to
+  stdout with a single write.
+- Table row functions: patient and schedule rows laid out exactly
+  like the printf-based display functions.
+*/
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <unistd.h>
+#endif
+
+#include "render.h"
+
+
+//////////////////////////////////////
+// RENDER HELPER FUNCTIONS
+//////////////////////////////////////
+
+// Write bytes straight to stdout, after anything printf has buffered (returns 1 on success, 0 on failure)
+static int writeOutput(const char* bytes, size_t length)
+{
+#ifndef _WIN32
+    ssize_t written = 0;
+
+    if (fflush(stdout) != 0)
+        return 0;
+
+    while (length > 0)
+    {
+        written = write(STDOUT_FILENO, bytes, length);
+        if (written > 0)
+        {
+            bytes += written;
+            length -= (size_t)written;
+        }
+        else if (written == 0 || errno != EINTR)
+            return 0;
+    }
+
+    return 1;
+#else
+    return fwrite(bytes, 1, length, stdout) == length && fflush(stdout) == 0;
+#endif
+}
+
+// Make room for 'length' more bytes, writing the buffer out if it is full
+static void reserveOutput(struct RenderBuffer* buffer, size_t length)
+{
+    if (buffer->length + length > RENDER_BUFFER_SIZE)
+        renderFlush(buffer);
+}
+
+// Append raw bytes
+static void renderBytes(struct RenderBuffer* buffer, const char* bytes, size_t length)
+{
+    if (length > RENDER_BUFFER_SIZE)
+    {
+        renderFlush(buffer);
+        writeOutput(bytes, length);
+    }
+    else
+    {
+        reserveOutput(buffer, length);
+        memcpy(buffer->text + buffer->length, bytes, length);
+        buffer->length += length;
+    }
+}
+
+// Append a character repeated 'count' times
+static void renderRepeat(struct RenderBuffer* buffer, char c, int count)
+{
+    if (count > 0)
+    {
+        reserveOutput(buffer, (size_t)count);
+        memset(buffer->text + buffer->length, c, (size_t)count);
+        buffer->length += (size_t)count;
+    }
+}
+
+
+//////////////////////////////////////
+// RENDER FUNCTIONS
+//////////////////////////////////////
+
+// Write the buffered output to stdout in one write and empty the buffer (returns 1 on success, 0 on failure)
+int renderFlush(struct RenderBuffer* buffer)
+{
+    int written = buffer->length == 0 || writeOutput(buffer->text, buffer->length);
+
+    buffer->length = 0;
+
+    return written;
+}
+
+// Append a C string
+void renderText(struct RenderBuffer* buffer, const char* text)
+{
+    renderBytes(buffer, text, strlen(text));
+}
+
+// Append a C string left-aligned in a field of spaces (like "%-*s")
+void renderPadded(struct RenderBuffer* buffer, const char* text, int width)
+{
+    size_t length = strlen(text);
+
+    renderBytes(buffer, text, length);
+    renderRepeat(buffer, ' ', width - (int)length);
+}
+
+// Append an integer zero-padded to a width (like "%0*d")
+void renderInt(struct RenderBuffer* buffer, int value, int width)
+{
+    char digits[16];
+    int count = 0, isNegative = value < 0;
+    unsigned int magnitude = isNegative ? 0u - (unsigned int)value : (unsigned int)value;
+
+    // Digits come out least significant first
+    do {
+        digits[sizeof(digits) - 1 - count++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+
+    if (isNegative)
+        renderBytes(buffer, "-", 1);
+    renderRepeat(buffer, '0', width - count - isNegative);
+    renderBytes(buffer, digits + sizeof(digits) - count, (size_t)count);
+}
+
+// Append a non-negative integer right-aligned in a field of spaces (like "%*d")
+void renderSpaced(struct RenderBuffer* buffer, int value, int width)
+{
+    int digits = 1, rest = value;
+
+    for (; rest >= 10; rest /= 10)
+        digits++;
+
+    renderRepeat(buffer, ' ', width - digits);
+    renderInt(buffer, value, 0);
+}
+
+// Append a packed phone number as (###)###-#### (or (___)___-____ if there is none)
+void renderPhone(struct RenderBuffer* buffer, long long phoneKey)
+{
+    char formatted[] = "(___)___-____";
+    static const int positions[PHONE_LEN] = { 1, 2, 3, 5, 6, 7, 9, 10, 11, 12 };
+    long long digits = phoneKey - 1;
+    int i = 0;
+
+    // Digits come out least significant first
+    for (i = PHONE_LEN - 1; phoneKey > 0 && i >= 0; i--, digits /= 10)
+        formatted[positions[i]] = (char)('0' + digits % 10);
+
+    renderBytes(buffer, formatted, sizeof(formatted) - 1);
+}
+
+
+//////////////////////////////////////
+// TABLE ROW FUNCTIONS
+//////////////////////////////////////
+
+// Append a patient table row (same layout as displayPatientData with FMT_TABLE)
+void renderPatientRow(struct RenderBuffer* buffer, const struct Patient* patient)
+{
+    renderInt(buffer, patient->patientNumber, 5);
+    renderBytes(buffer, " ", 1);
+    renderPadded(buffer, patient->name, NAME_LEN);
+    renderBytes(buffer, " ", 1);
+    renderPhone(buffer, patient->phoneKey);
+    renderBytes(buffer, " (", 2);
+    renderText(buffer, phoneTypeName(patient->phoneType));
+    renderBytes(buffer, ")\n", 2);
+}
+
+// Append a schedule table row (same layout as displayScheduleData)
+void renderScheduleRow(struct RenderBuffer* buffer, const struct Patient* patient,
+                       const struct Appointment* appoint, int includeDateField)
+{
+    struct Date date = { 0 };
+    struct Time time = { 0 };
+
+    unpackAppointment(appoint, &date, &time);
+
+    if (includeDateField)
+    {
+        renderInt(buffer, date.year, 4);
+        renderBytes(buffer, "-", 1);
+        renderInt(buffer, date.month, 2);
+        renderBytes(buffer, "-", 1);
+        renderInt(buffer, date.day, 2);
+        renderBytes(buffer, " ", 1);
+    }
+    renderInt(buffer, time.hour, 2);
+    renderBytes(buffer, ":", 1);
+    renderInt(buffer, time.min, 2);
+    renderBytes(buffer, " ", 1);
+    renderSpaced(buffer, appoint->room, 2);
+    renderBytes(buffer, " ", 1);
+    renderSpaced(buffer, visitMinutes(appoint), 3);
+    renderBytes(buffer, " ", 1);
+    renderPatientRow(buffer, patient);
+}
@@ -0,0 +1,56 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <stddef.h>
+
+#include "clinic.h"
+
+// Bytes a render buffer holds before it is written out
+#define RENDER_BUFFER_SIZE (64 * 1024)
+
+//////////////////////////////////////
+// Structures
+//////////////////////////////////////
+
+// Data type: Render Buffer (formatted output waiting to be written to stdout)
+struct RenderBuffer
+{
+    size_t length;
+    char text[RENDER_BUFFER_SIZE];
+};
+
+//////////////////////////////////////
+// RENDER FUNCTIONS
+//////////////////////////////////////
+
+// Write the buffered output to stdout in one write and empty the buffer (returns 1 on success, 0 on failure)
+int renderFlush(struct RenderBuffer* buffer);
+
+// Append a C string
+void renderText(struct RenderBuffer* buffer, const char* text);
+
+// Append a C string left-aligned in a field of spaces (like "%-*s")
+void renderPadded(struct RenderBuffer* buffer, const char* text, int width);
+
+// Append an integer zero-padded to a width (like "%0*d")
+void renderInt(struct RenderBuffer* buffer, int value, int width);
+
+// Append a non-negative integer right-aligned in a field of spaces (like "%*d")
+void renderSpaced(struct RenderBuffer* buffer, int value, int width);
+
+// Append a packed phone number as (###)###-#### (or (___)___-____ if there is none)
+void renderPhone(struct RenderBuffer* buffer, long long phoneKey);
+
+
+//////////////////////////////////////
+// TABLE ROW FUNCTIONS
+//////////////////////////////////////
+
+// Append a patient table row (same layout as displayPatientData with FMT_TABLE)
+void renderPatientRow(struct RenderBuffer* buffer, const struct Patient* patient);
+
+// Append a schedule table row (same layout as displayScheduleData)
+void renderScheduleRow(struct RenderBuffer* buffer, const struct Patient* patient,
+                       const struct Appointment* appoint, int includeDateField);
+
+#endif // !RENDER_H
@@ -0,0 +1,672 @@
+/*
+Server module
+- Server functions: serve the batch commands to local clients over a
+  Unix domain socket until SIGINT or SIGTERM. A single epoll loop owns
+  every connection and hands complete command lines to the workers.
+- Connection functions: non-blocking buffered reads and writes. A
+  connection has at most one command with the workers at a time, so
+  its replies come back in the order its commands were sent.
+- Worker functions: run queries on the published version of the data
+  without a lock, and changes on the working data one at a time. A
+  change waits for its journal sync and for a version that includes
+  it outside the lock, so changes made at the same time share one
+  fsync and one publish.
+*/
+
+#define _CRT_SECURE_NO_WARNINGS
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "batch.h"
+#include "server.h"
+#include "store.h"
+#include "version.h"
+
+#ifdef __linux__
+
+//////////////////////////////////////
+// Structures
+//////////////////////////////////////
+
+// Data type: Connection (one client socket, its buffers and the command it has with the workers)
+struct Connection
+{
+    int fd;
+    unsigned int events;
+    char* input;
+    int inputLength;
+    int inputCapacity;
+    char* output;
+    int outputLength;
+    int outputCapacity;
+    int outputSent;
+    char line[BATCH_LINE_LEN];
+    int lineLength;
+    char* reply;
+    size_t replyLength;
+    int isBusy;
+    int isSkipping;
+    int isEof;
+    int isBroken;
+    struct Connection* next;
+    struct Connection* prevOpen;
+    struct Connection* nextOpen;
+};
+
+// Data type: Server (listening socket, epoll loop state, the worker pool and the published data)
+struct Server
+{
+    struct ClinicData* data;
+    struct VersionStore versions;
+    int epollFd;
+    int listenFd;
+    int wakeFd;
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    struct Connection* firstJob;
+    struct Connection* lastJob;
+    struct Connection* finished;
+    struct Connection* open;
+    struct Connection* closed;
+    int stopping;
+    pthread_t workers[SERVER_MAX_WORKERS];
+    int workerCount;
+    int readerCount;
+};
+
+// Written to by the signal handler to stop the loop
+static int stopFd = -1;
+
+
+//////////////////////////////////////
+// SERVER HELPER FUNCTIONS
+//////////////////////////////////////
+
+// Ask the event loop to stop (signal handler; only async-signal-safe calls)
+static void requestStop(int signalNumber)
+{
+    uint64_t one = 1;
+    ssize_t written = 0;
+
+    (void)signalNumber;
+    if (stopFd != -1)
+        written = write(stopFd, &one, sizeof(one));
+    (void)written;
+}
+
+// Switch a descriptor to non-blocking mode (returns 1 on success, 0 on failure)
+static int setNonBlocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+
+    return flags != -1 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+// Register a descriptor with epoll, tagged with 'tag' (returns 1 on success, 0 on failure)
+static int watchDescriptor(int epollFd, int fd, void* tag)
+{
+    struct epoll_event event;
+
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.ptr = tag;
+
+    return epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) == 0;
+}
+
+// Open the listening socket, refusing to take over one a live server is using (returns -1 on failure)
+static int openListener(const char* socketPath)
+{
+    struct sockaddr_un address;
+    int fd = -1;
+
+    if (strlen(socketPath) >= sizeof(address.sun_path))
+    {
+        fprintf(stderr, "ERROR: Socket path %s is too long\n", socketPath);
+        return -1;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socketPath);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1)
+        return -1;
+
+    // A socket file nobody answers on was left behind by a server that did not stop cleanly
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) == 0)
+    {
+        fprintf(stderr, "ERROR: A server is already listening on %s\n", socketPath);
+        close(fd);
+        return -1;
+    }
+    close(fd);
+    unlink(socketPath);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1 || bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+        listen(fd, SERVER_BACKLOG) != 0 || !setNonBlocking(fd))
+    {
+        fprintf(stderr, "ERROR: Could not listen on %s\n", socketPath);
+        if (fd != -1)
+            close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+
+//////////////////////////////////////
+// CONNECTION FUNCTIONS
+//////////////////////////////////////
+
+// Append bytes to a connection's unsent output (the connection breaks if out of memory)
+static void queueOutput(struct Connection* conn, const char* bytes, size_t length)
+{
+    if (!growArray((void**)&conn->output, &conn->outputCapacity,
+                   conn->outputLength + (int)length, sizeof(char)))
+        conn->isBroken = 1;
+    else
+    {
+        memcpy(conn->output + conn->outputLength, bytes, length);
+        conn->outputLength += (int)length;
+    }
+}
+
+// Read everything the client has sent, up to SERVER_INPUT_LIMIT buffered bytes
+static void readInput(struct Connection* conn)
+{
+    ssize_t received = 0;
+
+    while (!conn->isEof && !conn->isBroken && conn->inputLength < SERVER_INPUT_LIMIT)
+    {
+        if (!growArray((void**)&conn->input, &conn->inputCapacity, SERVER_INPUT_LIMIT, sizeof(char)))
+        {
+            conn->isBroken = 1;
+            return;
+        }
+
+        received = recv(conn->fd, conn->input + conn->inputLength,
+                        (size_t)(SERVER_INPUT_LIMIT - conn->inputLength), 0);
+        if (received > 0)
+            conn->inputLength += (int)received;
+        else if (received == 0)
+            conn->isEof = 1;
+        else if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return;
+        else if (errno != EINTR)
+            conn->isBroken = 1;
+    }
+}
+
+// Send as much queued output as the socket takes
+static void writeOutput(struct Connection* conn)
+{
+    ssize_t sent = 0;
+
+    while (!conn->isBroken && conn->outputSent < conn->outputLength)
+    {
+        sent = send(conn->fd, conn->output + conn->outputSent,
+                    (size_t)(conn->outputLength - conn->outputSent), MSG_NOSIGNAL);
+        if (sent > 0)
+            conn->outputSent += (int)sent;
+        else if (sent == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
+        else if (sent == -1 && errno != EINTR)
+            conn->isBroken = 1;
+    }
+
+    if (conn->outputSent == conn->outputLength)
+        conn->outputSent = conn->outputLength = 0;
+}
+
+// Drop the first 'length' buffered input bytes
+static void consumeInput(struct Connection* conn, int length)
+{
+    memmove(conn->input, conn->input + length, (size_t)(conn->inputLength - length));
+    conn->inputLength -= length;
+}
+
+// Take the next command line from the input into conn->line (returns 1 if there is one to run)
+static int takeLine(struct Connection* conn)
+{
+    const char* lineBreak = NULL;
+    int length = 0;
+
+    while (conn->inputLength > 0)
+    {
+        lineBreak = memchr(conn->input, '\n', (size_t)conn->inputLength);
+
+        // The last line may end without a line break once the client has finished sending
+        if (lineBreak == NULL && !conn->isEof)
+        {
+            // Like batch mode, a line too long for a command is answered with one error
+            if (conn->inputLength > BATCH_LINE_LEN - 1 && !conn->isSkipping)
+            {
+                queueOutput(conn, "error|command line is too long\n", 31);
+                conn->isSkipping = 1;
+            }
+            if (conn->isSkipping)
+                conn->inputLength = 0;
+            return 0;
+        }
+
+        length = lineBreak != NULL ? (int)(lineBreak - conn->input) : conn->inputLength;
+        if (conn->isSkipping)
+        {
+            conn->isSkipping = 0;
+            consumeInput(conn, lineBreak != NULL ? length + 1 : length);
+            continue;
+        }
+        if (length > BATCH_LINE_LEN - 1)
+        {
+            queueOutput(conn, "error|command line is too long\n", 31);
+            consumeInput(conn, lineBreak != NULL ? length + 1 : length);
+            continue;
+        }
+
+        memcpy(conn->line, conn->input, (size_t)length);
+        consumeInput(conn, lineBreak != NULL ? length + 1 : length);
+
+        // Accept clients that send CRLF line endings
+        while (length > 0 && conn->line[length - 1] == '\r')
+            length--;
+        conn->lineLength = length;
+
+        if (length > 0 && conn->line[0] != '#')
+            return 1;
+    }
+
+    return 0;
+}
+
+// Close a connection (it is freed after the current batch of events, which may still name it)
+static void closeConnection(struct Server* server, struct Connection* conn)
+{
+    epoll_ctl(server->epollFd, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+    conn->fd = -1;
+
+    if (conn->prevOpen != NULL)
+        conn->prevOpen->nextOpen = conn->nextOpen;
+    else
+        server->open = conn->nextOpen;
+    if (conn->nextOpen != NULL)
+        conn->nextOpen->prevOpen = conn->prevOpen;
+
+    conn->next = server->closed;
+    server->closed = conn;
+}
+
+// Free the connections closed since the last call
+static void freeClosedConnections(struct Server* server)
+{
+    struct Connection* conn = NULL;
+
+    while ((conn = server->closed) != NULL)
+    {
+        server->closed = conn->next;
+        free(conn->input);
+        free(conn->output);
+        free(conn->reply);
+        free(conn);
+    }
+}
+
+// Hand a connection's next command to the workers, send its replies and update what epoll watches for it
+static void serviceConnection(struct Server* server, struct Connection* conn)
+{
+    struct epoll_event event;
+
+    if (!conn->isBusy && !conn->isBroken &&
+        conn->outputLength - conn->outputSent < SERVER_OUTPUT_LIMIT && takeLine(conn))
+    {
+        conn->isBusy = 1;
+        conn->next = NULL;
+
+        pthread_mutex_lock(&server->lock);
+        if (server->lastJob != NULL)
+            server->lastJob->next = conn;
+        else
+            server->firstJob = conn;
+        server->lastJob = conn;
+        pthread_cond_signal(&server->work);
+        pthread_mutex_unlock(&server->lock);
+    }
+
+    writeOutput(conn);
+
+    // A connection stays open while it has a command running, lines to run or replies to send
+    if (!conn->isBusy &&
+        (conn->isBroken || (conn->isEof && conn->inputLength == 0 && conn->outputLength == 0)))
+    {
+        closeConnection(server, conn);
+        return;
+    }
+
+    memset(&event, 0, sizeof(event));
+    event.events = (!conn->isEof && conn->inputLength < SERVER_INPUT_LIMIT ? EPOLLIN : 0u) |
+                   (conn->outputLength > 0 ? EPOLLOUT : 0u);
+    event.data.ptr = conn;
+    if (event.events != conn->events &&
+        epoll_ctl(server->epollFd, EPOLL_CTL_MOD, conn->fd, &event) == 0)
+        conn->events = event.events;
+}
+
+// Accept every waiting client
+static void acceptConnections(struct Server* server)
+{
+    struct Connection* conn = NULL;
+    int fd = -1;
+
+    while ((fd = accept(server->listenFd, NULL, NULL)) != -1)
+    {
+        conn = calloc(1, sizeof(*conn));
+        if (conn == NULL || !setNonBlocking(fd) || !watchDescriptor(server->epollFd, fd, conn))
+        {
+            free(conn);
+            close(fd);
+            continue;
+        }
+
+        conn->fd = fd;
+        conn->events = EPOLLIN;
+        conn->nextOpen = server->open;
+        if (server->open != NULL)
+            server->open->prevOpen = conn;
+        server->open = conn;
+    }
+}
+
+// Send the replies of the commands the workers have finished
+static void collectReplies(struct Server* server)
+{
+    struct Connection* conn = NULL;
+    struct Connection* done = NULL;
+    uint64_t count = 0;
+
+    if (read(server->wakeFd, &count, sizeof(count)) != (ssize_t)sizeof(count))
+        return;
+
+    pthread_mutex_lock(&server->lock);
+    done = server->finished;
+    server->finished = NULL;
+    pthread_mutex_unlock(&server->lock);
+
+    while ((conn = done) != NULL)
+    {
+        done = conn->next;
+        conn->isBusy = 0;
+
+        if (conn->reply != NULL)
+            queueOutput(conn, conn->reply, conn->replyLength);
+        else
+            queueOutput(conn, "error|server is out of memory\n", 30);
+        free(conn->reply);
+        conn->reply = NULL;
+
+        serviceConnection(server, conn);
+    }
+}
+
+
+//////////////////////////////////////
+// WORKER FUNCTIONS
+//////////////////////////////////////
+
+// Run a connection's command line into its reply (as reader number 'reader')
+static void runJob(struct Server* server, struct Connection* conn, int reader)
+{
+    const char* end = conn->line + conn->lineLength;
+    unsigned long long change = 0, lsn = 0;
+    int succeeded = 0, isSynced = 1;
+    FILE* out = open_memstream(&conn->reply, &conn->replyLength);
+
+    // Without a reply the server loop answers that it is out of memory
+    if (out == NULL)
+    {
+        conn->reply = NULL;
+        return;
+    }
+
+    if (isBatchChange(conn->line, end))
+    {
+        // The change's own journal record is the one to wait for, whatever is journaled after it
+        versionBeginChange(&server->versions);
+        succeeded = runBatchLine(server->data, conn->line, end, out);
+        lsn = server->data->lastLsn;
+        change = versionEndChange(&server->versions, conn->line, end, succeeded);
+
+        // The reply waits until the change is on disk and visible to queries, but other changes do not
+        isSynced = !succeeded || journalSyncTo(server->data, lsn);
+        if (!versionPublish(&server->versions, server->data, change))
+            fprintf(stderr, "ERROR: Could not publish the clinic data to queries\n");
+    }
+    else
+    {
+        runBatchLine(versionEnter(&server->versions, reader), conn->line, end, out);
+        versionLeave(&server->versions, reader);
+    }
+
+    // A change that did not reach the disk is not confirmed: its reply is written over
+    // (the reply ends at the stream position)
+    if (!isSynced)
+    {
+        rewind(out);
+        fprintf(out, "error|change could not be journaled\n");
+    }
+
+    if (fclose(out) != 0)
+    {
+        free(conn->reply);
+        conn->reply = NULL;
+    }
+}
+
+// Worker thread: run queued commands until the server stops
+static void* runWorker(void* arg)
+{
+    struct Server* server = arg;
+    struct Connection* conn = NULL;
+    uint64_t one = 1;
+    int reader = 0;
+
+    pthread_mutex_lock(&server->lock);
+    reader = server->readerCount++;
+    while (server->firstJob != NULL || !server->stopping)
+    {
+        if (server->firstJob == NULL)
+            pthread_cond_wait(&server->work, &server->lock);
+        else
+        {
+            conn = server->firstJob;
+            server->firstJob = conn->next;
+            if (server->firstJob == NULL)
+                server->lastJob = NULL;
+            pthread_mutex_unlock(&server->lock);
+
+            runJob(server, conn, reader);
+
+            pthread_mutex_lock(&server->lock);
+            conn->next = server->finished;
+            server->finished = conn;
+            if (write(server->wakeFd, &one, sizeof(one)) != (ssize_t)sizeof(one))
+                fprintf(stderr, "ERROR: Could not wake the server loop\n");
+        }
+    }
+    pthread_mutex_unlock(&server->lock);
+
+    return NULL;
+}
+
+// Start one worker per core, up to SERVER_MAX_WORKERS (returns # started)
+static int startWorkers(struct Server* server)
+{
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (count < 1)
+        count = 1;
+    if (count > SERVER_MAX_WORKERS)
+        count = SERVER_MAX_WORKERS;
+
+    while (server->workerCount < count &&
+           pthread_create(&server->workers[server->workerCount], NULL, runWorker, server) == 0)
+        server->workerCount++;
+
+    return server->workerCount;
+}
+
+// Let the workers finish the queued commands, then wait for them to exit
+static void stopWorkers(struct Server* server)
+{
+    int i = 0;
+
+    pthread_mutex_lock(&server->lock);
+    server->stopping = 1;
+    pthread_cond_broadcast(&server->work);
+    pthread_mutex_unlock(&server->lock);
+
+    for (i = 0; i < server->workerCount; i++)
+        pthread_join(server->workers[i], NULL);
+    server->workerCount = 0;
+}
+
+
+//////////////////////////////////////
+// SERVER FUNCTIONS
+//////////////////////////////////////
+
+// Serve the batch commands to local clients until SIGINT or SIGTERM (returns 1 on a clean stop, 0 on failure)
+int runServer(const char* socketPath, struct ClinicData* data)
+{
+    struct epoll_event events[SERVER_EVENTS];
+    struct sigaction action;
+    struct Server server;
+    struct Connection* conn = NULL;
+    int i = 0, count = 0, isRunning = 1, served = 0, hasVersions = 0;
+
+    memset(&server, 0, sizeof(server));
+    server.data = data;
+    server.epollFd = epoll_create1(0);
+    server.wakeFd = eventfd(0, EFD_NONBLOCK);
+    stopFd = eventfd(0, EFD_NONBLOCK);
+    server.listenFd = openListener(socketPath);
+    pthread_mutex_init(&server.lock, NULL);
+    pthread_cond_init(&server.work, NULL);
+
+    // Queries read published copies of the data, so the server needs room for two more copies
+    hasVersions = versionStoreInit(&server.versions, data);
+    if (!hasVersions)
+        fprintf(stderr, "ERROR: Not enough memory to publish the clinic data\n");
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = requestStop;
+    sigemptyset(&action.sa_mask);
+
+    if (server.epollFd != -1 && server.wakeFd != -1 && stopFd != -1 && server.listenFd != -1 &&
+        watchDescriptor(server.epollFd, server.listenFd, &server.listenFd) &&
+        watchDescriptor(server.epollFd, server.wakeFd, &server.wakeFd) &&
+        watchDescriptor(server.epollFd, stopFd, &stopFd) &&
+        sigaction(SIGINT, &action, NULL) == 0 && sigaction(SIGTERM, &action, NULL) == 0 &&
+        hasVersions && startWorkers(&server) > 0)
+    {
+        // Changes are acknowledged after their journal sync, which the workers wait for themselves
+        journalDeferSync(data, 1);
+        printf("Serving %s with %d workers (SIGINT or SIGTERM stops)...\n", socketPath, server.workerCount);
+        fflush(stdout);
+        served = 1;
+
+        while (isRunning)
+        {
+            count = epoll_wait(server.epollFd, events, SERVER_EVENTS, -1);
+            if (count == -1 && errno != EINTR)
+                isRunning = 0;
+
+            for (i = 0; i < count; i++)
+            {
+                if (events[i].data.ptr == &server.listenFd)
+                    acceptConnections(&server);
+                else if (events[i].data.ptr == &server.wakeFd)
+                    collectReplies(&server);
+                else if (events[i].data.ptr == &stopFd)
+                    isRunning = 0;
+                else
+                {
+                    conn = events[i].data.ptr;
+                    if (conn->fd == -1)
+                        continue;
+                    if (events[i].events & EPOLLERR)
+                        conn->isBroken = 1;
+                    if (events[i].events & (EPOLLIN | EPOLLHUP))
+                        readInput(conn);
+                    serviceConnection(&server, conn);
+                }
+            }
+            freeClosedConnections(&server);
+        }
+
+        // Commands already with the workers still finish (and reach the journal) before the data is freed
+        stopWorkers(&server);
+        if (!journalSync(data))
+            served = 0;
+        journalDeferSync(data, 0);
+    }
+    else if (server.listenFd != -1 && hasVersions)
+        fprintf(stderr, "ERROR: Could not start the server\n");
+
+    while (server.open != NULL)
+        closeConnection(&server, server.open);
+    freeClosedConnections(&server);
+    versionStoreFree(&server.versions);
+
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    if (server.listenFd != -1)
+    {
+        close(server.listenFd);
+        unlink(socketPath);
+    }
+    if (server.wakeFd != -1)
+        close(server.wakeFd);
+    if (stopFd != -1)
+        close(stopFd);
+    stopFd = -1;
+    if (server.epollFd != -1)
+        close(server.epollFd);
+    pthread_mutex_destroy(&server.lock);
+    pthread_cond_destroy(&server.work);
+
+    return served;
+}
+
+#else
+
+// Serve the batch commands to local clients until SIGINT or SIGTERM (returns 1 on a clean stop, 0 on failure)
+int runServer(const char* socketPath, struct ClinicData* data)
+{
+    (void)socketPath;
+    (void)data;
+    fprintf(stderr, "ERROR: Server mode needs Linux (epoll)\n");
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "clinic.h"
+
+// Unix domain socket the server listens on (when no other path is given)
+#define SERVER_SOCKET "clinic.sock"
+
+// Most worker threads running commands (one per core up to this many)
+#define SERVER_MAX_WORKERS 16
+
+// Connections the listening socket queues before they are accepted
+#define SERVER_BACKLOG 128
+
+// Events taken from epoll per wait
+#define SERVER_EVENTS 64
+
+// Unread command bytes a connection buffers before it stops being read
+#define SERVER_INPUT_LIMIT (64 * 1024)
+
+// Unsent reply bytes a connection buffers before its next command waits
+#define SERVER_OUTPUT_LIMIT (64 * 1024)
+
+//////////////////////////////////////
+// SERVER FUNCTIONS
+//////////////////////////////////////
+
+// Serve the batch commands to local clients until SIGINT or SIGTERM (returns 1 on a clean stop, 0 on failure)
+int runServer(const char* socketPath, struct ClinicData* data);
+
+#endif // !SERVER_H
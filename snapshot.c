@@ -0,0 +1,627 @@
+/*
+Snapshot module
+- Snapshot functions: versioned, checksummed binary image of the
+  clinic data store and its indexes, laid out so it can be mapped
+  straight into memory at startup
+- Checksum functions: FNV-1a over blocks of bytes (shared with the
+  journal)
+- File sync functions: flush files and renames through to the disk
+  (shared with the journal)
+*/
+
+#define _CRT_SECURE_NO_WARNINGS
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+#include "clinic.h"
+#include "snapshot.h"
+#include "store.h"
+
+// File identification
+#define SNAPSHOT_MAGIC "VETSNAP"
+#define SNAPSHOT_BYTE_ORDER 0x01020304u
+
+// Every section starts on this boundary so mapped arrays are aligned
+#define SNAPSHOT_ALIGN 16
+
+// Sections (stored in this order)
+#define SECTION_PATIENTS 0
+#define SECTION_APPOINTMENTS 1
+#define SECTION_PATIENT_INDEX 2
+#define SECTION_PHONE_INDEX 3
+#define SECTION_PHONE_CHAINS 4
+#define SECTION_FREE_SLOTS 5
+#define SECTION_APPOINTMENT_GENERATIONS 6
+#define SECTION_APPOINTMENT_ORDER 7
+#define SECTION_TIMESLOTS 8
+#define SECTION_NAME_INDEX 9
+#define SECTION_NAME_NODES 10
+#define SECTION_APPOINTMENT_INDEX 11
+#define SECTION_APPOINTMENT_CHAINS 12
+#define SECTION_PHONE_PREVIOUS 13
+#define SECTION_APPOINTMENT_PREVIOUS 14
+#define SNAPSHOT_SECTIONS 15
+
+//////////////////////////////////////
+// Structures
+//////////////////////////////////////
+
+// Data type: Snapshot Section (one stored array)
+struct SnapshotSection
+{
+    unsigned long long offset;
+    int count;
+    int itemSize;
+};
+
+// Data type: Snapshot Header (start of every snapshot file)
+struct SnapshotHeader
+{
+    char magic[8];
+    unsigned int version;
+    unsigned int byteOrder;
+    unsigned int payloadChecksum;
+    unsigned int headerChecksum;
+    unsigned long long fileSize;
+    unsigned long long lastLsn;
+    int lastPatientNumber;
+    int appointmentCount;
+    int freeAppointmentSlot;
+    int patientIndexCount;
+    int patientIndexRemoved;
+    int phoneIndexCount;
+    int phoneIndexRemoved;
+    int nameIndexCount;
+    int nameIndexRemoved;
+    int appointmentIndexCount;
+    int appointmentIndexRemoved;
+    int timeslotFirstKey;
+    struct SnapshotSection sections[SNAPSHOT_SECTIONS];
+};
+
+
+//////////////////////////////////////
+// SNAPSHOT HELPER FUNCTIONS
+//////////////////////////////////////
+
+// Checksum a header with its own checksum field cleared
+static unsigned int checksumHeader(const struct SnapshotHeader* header)
+{
+    struct SnapshotHeader copy = *header;
+
+    copy.headerChecksum = 0;
+
+    return checksumBytes(CHECKSUM_SEED, &copy, sizeof(copy));
+}
+
+// Round an offset up to the section alignment
+static unsigned long long alignOffset(unsigned long long offset)
+{
+    return (offset + SNAPSHOT_ALIGN - 1) / SNAPSHOT_ALIGN * SNAPSHOT_ALIGN;
+}
+
+// Map a whole file into memory (read into the heap where mmap is unavailable)
+static int mapFile(const char* fileName, struct MappedFile* mapping)
+{
+#ifndef _WIN32
+    int fd = -1;
+    struct stat info;
+    void* base = MAP_FAILED;
+
+    mapping->base = NULL;
+    mapping->size = 0;
+    mapping->isHeap = 0;
+
+    fd = open(fileName, O_RDONLY);
+    if (fd == -1)
+        return 0;
+
+    // Private writable mapping: in-place edits are copy-on-write, never written back
+    if (fstat(fd, &info) == 0 && info.st_size > 0)
+        base = mmap(NULL, (size_t)info.st_size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (base == MAP_FAILED)
+        return 0;
+
+    mapping->base = base;
+    mapping->size = (size_t)info.st_size;
+
+    return 1;
+#else
+    FILE* fp = NULL;
+    long length = 0;
+
+    mapping->base = NULL;
+    mapping->size = 0;
+    mapping->isHeap = 1;
+
+    fp = fopen(fileName, "rb");
+    if (fp == NULL)
+        return 0;
+
+    if (fseek(fp, 0, SEEK_END) == 0 && (length = ftell(fp)) > 0 &&
+        fseek(fp, 0, SEEK_SET) == 0)
+    {
+        mapping->base = malloc((size_t)length);
+        if (mapping->base != NULL &&
+            fread(mapping->base, 1, (size_t)length, fp) == (size_t)length)
+            mapping->size = (size_t)length;
+    }
+    fclose(fp);
+
+    if (mapping->size == 0)
+    {
+        free(mapping->base);
+        mapping->base = NULL;
+        return 0;
+    }
+
+    return 1;
+#endif
+}
+
+// Check a mapped header describes a snapshot this build can use
+static int isHeaderValid(const struct SnapshotHeader* header, size_t fileSize)
+{
+    int i = 0, valid = 1;
+    const int itemSizes[SNAPSHOT_SECTIONS] = {
+        (int)sizeof(struct Patient), (int)sizeof(struct Appointment),
+        (int)sizeof(struct PatientIndexEntry), (int)sizeof(struct MultiIndexEntry),
+        (int)sizeof(int), (int)sizeof(int), (int)sizeof(unsigned int), (int)sizeof(int),
+        (int)sizeof(unsigned long long), (int)sizeof(struct NameIndexEntry),
+        (int)sizeof(struct NameIndexNode), (int)sizeof(struct MultiIndexEntry), (int)sizeof(int),
+        (int)sizeof(int), (int)sizeof(int)
+    };
+
+    if (fileSize < sizeof(*header) ||
+        memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 ||
+        header->version != SNAPSHOT_VERSION ||
+        header->byteOrder != SNAPSHOT_BYTE_ORDER ||
+        header->fileSize != (unsigned long long)fileSize ||
+        header->headerChecksum != checksumHeader(header))
+        return 0;
+
+    for (i = 0; valid && i < SNAPSHOT_SECTIONS; i++)
+    {
+        valid = header->sections[i].itemSize == itemSizes[i] &&
+                header->sections[i].count >= 0 &&
+                header->sections[i].offset % SNAPSHOT_ALIGN == 0 &&
+                header->sections[i].offset +
+                    (unsigned long long)header->sections[i].count * (unsigned long long)itemSizes[i] <=
+                    (unsigned long long)fileSize;
+    }
+
+    // Every appointment slot has a generation and every chained slot links both ways. Links are checked
+    // against the chain arrays only as they are followed, so those arrays must not reach past the records
+    return valid && header->sections[SECTION_APPOINTMENT_GENERATIONS].count ==
+                    header->sections[SECTION_APPOINTMENTS].count &&
+           header->sections[SECTION_PHONE_PREVIOUS].count ==
+               header->sections[SECTION_PHONE_CHAINS].count &&
+           header->sections[SECTION_APPOINTMENT_PREVIOUS].count ==
+               header->sections[SECTION_APPOINTMENT_CHAINS].count &&
+           header->sections[SECTION_PHONE_CHAINS].count <= header->sections[SECTION_PATIENTS].count &&
+           header->sections[SECTION_APPOINTMENT_CHAINS].count <=
+               header->sections[SECTION_APPOINTMENTS].count &&
+           (long long)header->sections[SECTION_NAME_NODES].count <=
+               (long long)header->sections[SECTION_PATIENTS].count * NAME_INDEX_TRIGRAMS;
+}
+
+// Get the address of a mapped section (NULL if it is empty)
+static void* sectionAddress(const struct MappedFile* mapping,
+                            const struct SnapshotHeader* header, int section)
+{
+    return header->sections[section].count > 0 ?
+           (char*)mapping->base + header->sections[section].offset : NULL;
+}
+
+// Checksum every stored array of a mapped snapshot
+static unsigned int checksumPayload(const struct MappedFile* mapping, const struct SnapshotHeader* header)
+{
+    unsigned int checksum = CHECKSUM_SEED;
+    int i = 0;
+
+    for (i = 0; i < SNAPSHOT_SECTIONS; i++)
+        checksum = checksumBytes(checksum, sectionAddress(mapping, header, i),
+                                 (size_t)header->sections[i].count *
+                                 (size_t)header->sections[i].itemSize);
+
+    return checksum;
+}
+
+
+//////////////////////////////////////
+// SNAPSHOT FUNCTIONS
+//////////////////////////////////////
+
+// Write the clinic data and its indexes to a snapshot file (returns 1 on success, 0 on failure)
+int saveSnapshot(const char* snapshotFile, const struct ClinicData* data)
+{
+    struct SnapshotHeader header;
+    const void* arrays[SNAPSHOT_SECTIONS] = { NULL };
+    char tempFile[FILENAME_MAX] = { 0 };
+    static const char padding[SNAPSHOT_ALIGN] = { 0 };
+    unsigned long long offset = 0, position = 0;
+    size_t length = 0;
+    int i = 0, written = 1;
+    int phoneSlots = data->phoneIndex.slotCapacity < data->patientCount ?
+                     data->phoneIndex.slotCapacity : data->patientCount;
+    int appointmentSlots = data->appointmentIndex.slotCapacity < data->appointmentSlotCount ?
+                           data->appointmentIndex.slotCapacity : data->appointmentSlotCount;
+    int nameNodes = data->nameIndex.nodeCapacity / NAME_INDEX_TRIGRAMS < data->patientCount ?
+                    data->nameIndex.nodeCapacity : data->patientCount * NAME_INDEX_TRIGRAMS;
+    FILE* fp = NULL;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.byteOrder = SNAPSHOT_BYTE_ORDER;
+    header.lastLsn = data->lastLsn;
+    header.lastPatientNumber = data->lastPatientNumber;
+    header.appointmentCount = data->appointmentCount;
+    header.freeAppointmentSlot = data->freeAppointmentSlot;
+    header.timeslotFirstKey = data->timeslots.firstKey;
+    header.patientIndexCount = data->patientIndex.count;
+    header.patientIndexRemoved = data->patientIndex.removed;
+    header.phoneIndexCount = data->phoneIndex.count;
+    header.phoneIndexRemoved = data->phoneIndex.removed;
+    header.nameIndexCount = data->nameIndex.count;
+    header.nameIndexRemoved = data->nameIndex.removed;
+    header.appointmentIndexCount = data->appointmentIndex.count;
+    header.appointmentIndexRemoved = data->appointmentIndex.removed;
+
+    arrays[SECTION_PATIENTS] = data->patients;
+    header.sections[SECTION_PATIENTS].count = data->patientCount;
+    header.sections[SECTION_PATIENTS].itemSize = (int)sizeof(struct Patient);
+
+    arrays[SECTION_APPOINTMENTS] = data->appointments;
+    header.sections[SECTION_APPOINTMENTS].count = data->appointmentSlotCount;
+    header.sections[SECTION_APPOINTMENTS].itemSize = (int)sizeof(struct Appointment);
+
+    arrays[SECTION_PATIENT_INDEX] = data->patientIndex.entries;
+    header.sections[SECTION_PATIENT_INDEX].count = data->patientIndex.capacity;
+    header.sections[SECTION_PATIENT_INDEX].itemSize = (int)sizeof(struct PatientIndexEntry);
+
+    arrays[SECTION_PHONE_INDEX] = data->phoneIndex.entries;
+    header.sections[SECTION_PHONE_INDEX].count = data->phoneIndex.capacity;
+    header.sections[SECTION_PHONE_INDEX].itemSize = (int)sizeof(struct MultiIndexEntry);
+
+    arrays[SECTION_PHONE_CHAINS] = data->phoneIndex.nextSlot;
+    header.sections[SECTION_PHONE_CHAINS].count = phoneSlots;
+    header.sections[SECTION_PHONE_CHAINS].itemSize = (int)sizeof(int);
+
+    arrays[SECTION_FREE_SLOTS] = data->freeSlots;
+    header.sections[SECTION_FREE_SLOTS].count = data->freeSlotCount;
+    header.sections[SECTION_FREE_SLOTS].itemSize = (int)sizeof(int);
+
+    arrays[SECTION_APPOINTMENT_GENERATIONS] = data->appointmentGenerations;
+    header.sections[SECTION_APPOINTMENT_GENERATIONS].count = data->appointmentSlotCount;
+    header.sections[SECTION_APPOINTMENT_GENERATIONS].itemSize = (int)sizeof(unsigned int);
+
+    arrays[SECTION_APPOINTMENT_ORDER] = data->appointmentOrder;
+    header.sections[SECTION_APPOINTMENT_ORDER].count = data->appointmentOrderCount;
+    header.sections[SECTION_APPOINTMENT_ORDER].itemSize = (int)sizeof(int);
+
+    arrays[SECTION_TIMESLOTS] = data->timeslots.words;
+    header.sections[SECTION_TIMESLOTS].count = data->timeslots.count;
+    header.sections[SECTION_TIMESLOTS].itemSize = (int)sizeof(unsigned long long);
+
+    arrays[SECTION_NAME_INDEX] = data->nameIndex.entries;
+    header.sections[SECTION_NAME_INDEX].count = data->nameIndex.capacity;
+    header.sections[SECTION_NAME_INDEX].itemSize = (int)sizeof(struct NameIndexEntry);
+
+    arrays[SECTION_NAME_NODES] = data->nameIndex.nodes;
+    header.sections[SECTION_NAME_NODES].count = nameNodes;
+    header.sections[SECTION_NAME_NODES].itemSize = (int)sizeof(struct NameIndexNode);
+
+    arrays[SECTION_APPOINTMENT_INDEX] = data->appointmentIndex.entries;
+    header.sections[SECTION_APPOINTMENT_INDEX].count = data->appointmentIndex.capacity;
+    header.sections[SECTION_APPOINTMENT_INDEX].itemSize = (int)sizeof(struct MultiIndexEntry);
+
+    arrays[SECTION_APPOINTMENT_CHAINS] = data->appointmentIndex.nextSlot;
+    header.sections[SECTION_APPOINTMENT_CHAINS].count = appointmentSlots;
+    header.sections[SECTION_APPOINTMENT_CHAINS].itemSize = (int)sizeof(int);
+
+    arrays[SECTION_PHONE_PREVIOUS] = data->phoneIndex.prevSlot;
+    header.sections[SECTION_PHONE_PREVIOUS].count = phoneSlots;
+    header.sections[SECTION_PHONE_PREVIOUS].itemSize = (int)sizeof(int);
+
+    arrays[SECTION_APPOINTMENT_PREVIOUS] = data->appointmentIndex.prevSlot;
+    header.sections[SECTION_APPOINTMENT_PREVIOUS].count = appointmentSlots;
+    header.sections[SECTION_APPOINTMENT_PREVIOUS].itemSize = (int)sizeof(int);
+
+    // Lay the sections out after the header, each one aligned
+    offset = alignOffset(sizeof(header));
+    header.payloadChecksum = CHECKSUM_SEED;
+    for (i = 0; i < SNAPSHOT_SECTIONS; i++)
+    {
+        length = (size_t)header.sections[i].count * (size_t)header.sections[i].itemSize;
+        header.sections[i].offset = offset;
+        header.payloadChecksum = checksumBytes(header.payloadChecksum, arrays[i], length);
+        offset = alignOffset(offset + length);
+    }
+    header.fileSize = offset;
+    header.headerChecksum = checksumHeader(&header);
+
+    // Write to a temporary file and rename it so a crash never leaves half a snapshot
+    if (strlen(snapshotFile) + 5 > sizeof(tempFile))
+        return 0;
+    strcpy(tempFile, snapshotFile);
+    strcat(tempFile, ".tmp");
+
+    fp = fopen(tempFile, "wb");
+    if (fp == NULL)
+        return 0;
+
+    written = fwrite(&header, sizeof(header), 1, fp) == 1;
+    position = sizeof(header);
+    for (i = 0; written && i < SNAPSHOT_SECTIONS + 1; i++)
+    {
+        offset = i < SNAPSHOT_SECTIONS ? header.sections[i].offset : header.fileSize;
+        while (written && position < offset)
+        {
+            length = (size_t)(offset - position < SNAPSHOT_ALIGN ? offset - position : SNAPSHOT_ALIGN);
+            written = fwrite(padding, 1, length, fp) == length;
+            position += length;
+        }
+
+        if (i < SNAPSHOT_SECTIONS && written)
+        {
+            length = (size_t)header.sections[i].count * (size_t)header.sections[i].itemSize;
+            written = length == 0 || fwrite(arrays[i], 1, length, fp) == length;
+            position += length;
+        }
+    }
+
+    // The journal is trimmed once this snapshot is written, so it must reach the disk first
+    written = written && syncFile(fp);
+    if (fclose(fp) != 0)
+        written = 0;
+
+#ifdef _WIN32
+    if (written)
+        remove(snapshotFile);
+#endif
+    if (!written || rename(tempFile, snapshotFile) != 0)
+    {
+        remove(tempFile);
+        written = 0;
+    }
+
+    return written && syncDirectory(snapshotFile);
+}
+
+// Map a snapshot file, check its header and point an empty clinic data store at it (returns 1 on
+// success, 0 if it is missing, damaged or from another version)
+int loadSnapshot(const char* snapshotFile, struct ClinicData* data)
+{
+    struct MappedFile mapping = { 0 };
+    const struct SnapshotHeader* header = NULL;
+
+    if (!mapFile(snapshotFile, &mapping))
+        return 0;
+
+    // Only the header is read here, so pages are mapped in as they are used. The stored slots and links
+    // are checked as they are followed instead, and verifySnapshot checks the whole payload
+    header = mapping.base;
+    if (!isHeaderValid(header, mapping.size))
+    {
+        closeSnapshot(&mapping);
+        return 0;
+    }
+
+    // Point the store at the mapped arrays; they are copied only if they must grow
+    data->patients = sectionAddress(&mapping, header, SECTION_PATIENTS);
+    data->patientCount = header->sections[SECTION_PATIENTS].count;
+    data->patientCapacity = data->patientCount;
+    data->patientsBorrowed = data->patients != NULL;
+
+    data->appointments = sectionAddress(&mapping, header, SECTION_APPOINTMENTS);
+    data->appointmentSlotCount = header->sections[SECTION_APPOINTMENTS].count;
+    data->appointmentCapacity = data->appointmentSlotCount;
+    data->appointmentsBorrowed = data->appointments != NULL;
+    data->appointmentGenerations = sectionAddress(&mapping, header, SECTION_APPOINTMENT_GENERATIONS);
+    data->generationsBorrowed = data->appointmentGenerations != NULL;
+    data->appointmentOrder = sectionAddress(&mapping, header, SECTION_APPOINTMENT_ORDER);
+    data->appointmentOrderCount = header->sections[SECTION_APPOINTMENT_ORDER].count;
+    data->appointmentOrderCapacity = data->appointmentOrderCount;
+    data->appointmentOrderBorrowed = data->appointmentOrder != NULL;
+    data->appointmentCount = header->appointmentCount;
+    data->freeAppointmentSlot = header->freeAppointmentSlot;
+    data->timeslots.words = sectionAddress(&mapping, header, SECTION_TIMESLOTS);
+    data->timeslots.firstKey = header->timeslotFirstKey;
+    data->timeslots.count = header->sections[SECTION_TIMESLOTS].count;
+    data->timeslots.capacity = data->timeslots.count;
+    data->timeslots.borrowed = data->timeslots.words != NULL;
+
+    data->patientIndex.entries = sectionAddress(&mapping, header, SECTION_PATIENT_INDEX);
+    data->patientIndex.capacity = header->sections[SECTION_PATIENT_INDEX].count;
+    data->patientIndex.count = header->patientIndexCount;
+    data->patientIndex.removed = header->patientIndexRemoved;
+    data->patientIndex.borrowed = data->patientIndex.entries != NULL;
+
+    data->phoneIndex.entries = sectionAddress(&mapping, header, SECTION_PHONE_INDEX);
+    data->phoneIndex.capacity = header->sections[SECTION_PHONE_INDEX].count;
+    data->phoneIndex.count = header->phoneIndexCount;
+    data->phoneIndex.removed = header->phoneIndexRemoved;
+    data->phoneIndex.nextSlot = sectionAddress(&mapping, header, SECTION_PHONE_CHAINS);
+    data->phoneIndex.prevSlot = sectionAddress(&mapping, header, SECTION_PHONE_PREVIOUS);
+    data->phoneIndex.slotCapacity = header->sections[SECTION_PHONE_CHAINS].count;
+    data->phoneIndex.borrowed = data->phoneIndex.entries != NULL ||
+                                data->phoneIndex.nextSlot != NULL;
+
+    data->nameIndex.entries = sectionAddress(&mapping, header, SECTION_NAME_INDEX);
+    data->nameIndex.capacity = header->sections[SECTION_NAME_INDEX].count;
+    data->nameIndex.count = header->nameIndexCount;
+    data->nameIndex.removed = header->nameIndexRemoved;
+    data->nameIndex.nodes = sectionAddress(&mapping, header, SECTION_NAME_NODES);
+    data->nameIndex.nodeCapacity = header->sections[SECTION_NAME_NODES].count;
+    data->nameIndex.borrowed = data->nameIndex.entries != NULL ||
+                               data->nameIndex.nodes != NULL;
+
+    data->appointmentIndex.entries = sectionAddress(&mapping, header, SECTION_APPOINTMENT_INDEX);
+    data->appointmentIndex.capacity = header->sections[SECTION_APPOINTMENT_INDEX].count;
+    data->appointmentIndex.count = header->appointmentIndexCount;
+    data->appointmentIndex.removed = header->appointmentIndexRemoved;
+    data->appointmentIndex.nextSlot = sectionAddress(&mapping, header, SECTION_APPOINTMENT_CHAINS);
+    data->appointmentIndex.prevSlot = sectionAddress(&mapping, header, SECTION_APPOINTMENT_PREVIOUS);
+    data->appointmentIndex.slotCapacity = header->sections[SECTION_APPOINTMENT_CHAINS].count;
+    data->appointmentIndex.borrowed = data->appointmentIndex.entries != NULL ||
+                                      data->appointmentIndex.nextSlot != NULL;
+
+    data->freeSlots = sectionAddress(&mapping, header, SECTION_FREE_SLOTS);
+    data->freeSlotCount = header->sections[SECTION_FREE_SLOTS].count;
+    data->freeSlotCapacity = data->freeSlotCount;
+    data->freeSlotsBorrowed = data->freeSlots != NULL;
+
+    data->lastPatientNumber = header->lastPatientNumber;
+    data->lastLsn = header->lastLsn;
+    data->snapshot = mapping;
+
+    // Removing a patient never grows the free list, so it is given room for every patient now
+    if (!storeReservePatients(data, data->patientCount))
+    {
+        storeFree(data);
+        return 0;
+    }
+
+    return 1;
+}
+
+// Check a snapshot file's header and every stored array against their checksums (returns 1 if it is
+// intact, 0 if it is missing, damaged or from another version)
+int verifySnapshot(const char* snapshotFile)
+{
+    struct MappedFile mapping = { 0 };
+    int intact = 0;
+
+    if (!mapFile(snapshotFile, &mapping))
+        return 0;
+
+    intact = isHeaderValid(mapping.base, mapping.size) &&
+             checksumPayload(&mapping, mapping.base) ==
+                 ((const struct SnapshotHeader*)mapping.base)->payloadChecksum;
+    closeSnapshot(&mapping);
+
+    return intact;
+}
+
+// Check if a snapshot file exists and no data file was saved after it
+int isSnapshotCurrent(const char* snapshotFile, const char* patientFile,
+                      const char* appointmentFile)
+{
+    struct stat snapshotInfo, dataInfo;
+    int current = 0;
+
+    // A data file saved in the same second as the snapshot counts as older: discarding
+    // the snapshot would also discard the journal replayed over it
+    if (stat(snapshotFile, &snapshotInfo) == 0)
+    {
+        current = 1;
+        if (stat(patientFile, &dataInfo) == 0 && dataInfo.st_mtime > snapshotInfo.st_mtime)
+            current = 0;
+        if (stat(appointmentFile, &dataInfo) == 0 && dataInfo.st_mtime > snapshotInfo.st_mtime)
+            current = 0;
+    }
+
+    return current;
+}
+
+// Unmap the snapshot the clinic data store was loaded from
+void closeSnapshot(struct MappedFile* mapping)
+{
+    if (mapping->base != NULL)
+    {
+#ifndef _WIN32
+        if (!mapping->isHeap)
+            munmap(mapping->base, mapping->size);
+        else
+#endif
+            free(mapping->base);
+    }
+
+    mapping->base = NULL;
+    mapping->size = 0;
+    mapping->isHeap = 0;
+}
+
+
+//////////////////////////////////////
+// CHECKSUM FUNCTIONS
+//////////////////////////////////////
+
+// Continue an FNV-1a checksum over a block of bytes
+unsigned int checksumBytes(unsigned int checksum, const void* bytes, size_t length)
+{
+    const unsigned char* cur = bytes;
+    size_t i = 0;
+
+    for (i = 0; i < length; i++)
+    {
+        checksum ^= cur[i];
+        checksum *= 16777619u;
+    }
+
+    return checksum;
+}
+
+
+//////////////////////////////////////
+// FILE SYNC FUNCTIONS
+//////////////////////////////////////
+
+// Flush a file through to the disk (returns 1 on success, 0 on failure)
+int syncFile(FILE* fp)
+{
+    if (fflush(fp) != 0)
+        return 0;
+
+#ifndef _WIN32
+    return fsync(fileno(fp)) == 0;
+#else
+    return _commit(_fileno(fp)) == 0;
+#endif
+}
+
+// Flush the directory entry of a file just renamed into place through to the disk (returns 1 on success, 0 on failure)
+int syncDirectory(const char* fileName)
+{
+#ifndef _WIN32
+    char directory[FILENAME_MAX] = ".";
+    const char* slash = strrchr(fileName, '/');
+    int fd = -1, synced = 0;
+
+    if (slash != NULL && (size_t)(slash - fileName) < sizeof(directory))
+    {
+        // A file in the root directory keeps its slash
+        memcpy(directory, fileName, slash == fileName ? 1 : (size_t)(slash - fileName));
+        directory[slash == fileName ? 1 : slash - fileName] = '\0';
+    }
+
+    fd = open(directory, O_RDONLY);
+    if (fd == -1)
+        return 0;
+    synced = fsync(fd) == 0;
+    close(fd);
+
+    return synced;
+#else
+    // Windows commits a rename with the file itself
+    (void)fileName;
+
+    return 1;
+#endif
+}
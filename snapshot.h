@@ -0,0 +1,71 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+// Snapshot file written next to the text data files
+#define SNAPSHOT_FILE "clinicData.snap"
+
+// Snapshot format version (bump whenever a stored structure changes)
+#define SNAPSHOT_VERSION 10
+
+// Starting value of an FNV-1a checksum
+#define CHECKSUM_SEED 2166136261u
+
+struct ClinicData;
+
+//////////////////////////////////////
+// Structures
+//////////////////////////////////////
+
+// Data type: Mapped File (a snapshot mapped, or read, into memory)
+struct MappedFile
+{
+    void* base;
+    size_t size;
+    int isHeap;
+};
+
+//////////////////////////////////////
+// SNAPSHOT FUNCTIONS
+//////////////////////////////////////
+
+// Write the clinic data and its indexes to a snapshot file (returns 1 on success, 0 on failure)
+int saveSnapshot(const char* snapshotFile, const struct ClinicData* data);
+
+// Map a snapshot file, check its header and point an empty clinic data store at it (returns 1 on
+// success, 0 if it is missing, damaged or from another version)
+int loadSnapshot(const char* snapshotFile, struct ClinicData* data);
+
+// Check a snapshot file's header and every stored array against their checksums (returns 1 if it is
+// intact, 0 if it is missing, damaged or from another version)
+int verifySnapshot(const char* snapshotFile);
+
+// Check if a snapshot file exists and no data file was saved after it
+int isSnapshotCurrent(const char* snapshotFile, const char* patientFile,
+                      const char* appointmentFile);
+
+// Unmap the snapshot the clinic data store was loaded from
+void closeSnapshot(struct MappedFile* mapping);
+
+
+//////////////////////////////////////
+// CHECKSUM FUNCTIONS
+//////////////////////////////////////
+
+// Continue an FNV-1a checksum over a block of bytes
+unsigned int checksumBytes(unsigned int checksum, const void* bytes, size_t length);
+
+
+//////////////////////////////////////
+// FILE SYNC FUNCTIONS
+//////////////////////////////////////
+
+// Flush a file through to the disk (returns 1 on success, 0 on failure)
+int syncFile(FILE* fp);
+
+// Flush the directory entry of a file just renamed into place through to the disk (returns 1 on success, 0 on failure)
+int syncDirectory(const char* fileName);
+
+#endif // !SNAPSHOT_H
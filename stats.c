@@ -0,0 +1,244 @@
+/*
+Stats module
+- Stats functions: call counters, records scanned and HDR-style latency
+  histograms for the clinic operations. A histogram bucket covers 1/16
+  of a power of two, so any latency is kept to within about 6% in a
+  fixed table with no allocation. Counters are updated atomically,
+  so server workers record without a lock.
+- The statistics are listed by the "stats" batch command and written to
+  the file named by CLINIC_STATS_FILE at exit, one CSV row per operation:
+  operation,calls,scanned,mean_ns,p50_ns,p90_ns,p99_ns,max_ns
+- Building with CLINIC_NO_STATS compiles the measuring out entirely.
+*/
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <time.h>
+
+#include "stats.h"
+
+#ifndef CLINIC_NO_STATS
+
+// Operation names, in operation number order
+static const char* const operationNames[STATS_OPERATIONS] = {
+    "import-patients", "import-appointments", "find-patient", "find-phone", "view-patients",
+    "add-patient", "edit-patient", "remove-patient", "view-schedule", "view-appointments",
+    "find-appointment", "add-appointment", "remove-appointment", "free-timeslots", "free-rooms",
+    "find-name", "view-range", "patient-appointments"
+};
+
+static struct OperationStats operations[STATS_OPERATIONS];
+
+// Set on a thread whose recording is paused
+#if defined(__GNUC__) || defined(__clang__)
+static __thread int isThreadPaused;
+#else
+static int isThreadPaused;
+#endif
+
+//////////////////////////////////////
+// STATS HELPER FUNCTIONS
+//////////////////////////////////////
+
+// Add to a counter other threads may be adding to
+static void addCounter(unsigned long long* counter, unsigned long long amount)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    __atomic_fetch_add(counter, amount, __ATOMIC_RELAXED);
+#else
+    *counter += amount;
+#endif
+}
+
+// Read a counter other threads may be adding to
+static unsigned long long readCounter(const unsigned long long* counter)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+#else
+    return *counter;
+#endif
+}
+
+// Raise a maximum other threads may be raising
+static void raiseMaximum(unsigned long long* maximum, unsigned long long value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    unsigned long long seen = __atomic_load_n(maximum, __ATOMIC_RELAXED);
+
+    while (value > seen &&
+           !__atomic_compare_exchange_n(maximum, &seen, value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+#else
+    if (value > *maximum)
+        *maximum = value;
+#endif
+}
+
+// Get the position of the highest set bit (bits must not be 0)
+static int highestBit(unsigned long long bits)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(bits);
+#else
+    int position = 0;
+
+    while (bits >>= 1)
+        position++;
+
+    return position;
+#endif
+}
+
+// Get the histogram bucket of a latency (exact below 2 * STATS_SUB_BUCKETS ns, then
+// STATS_SUB_BUCKETS buckets per power of two)
+static int bucketOf(unsigned long long value)
+{
+    int shift = 0;
+
+    if (value < 2 * STATS_SUB_BUCKETS)
+        return (int)value;
+
+    // The leading bit and the next STATS_SUB_BUCKET_BITS bits pick the bucket
+    shift = highestBit(value) - STATS_SUB_BUCKET_BITS;
+
+    return shift * STATS_SUB_BUCKETS + (int)(value >> shift);
+}
+
+// Get the middle latency of a histogram bucket
+static unsigned long long bucketValue(int bucket)
+{
+    int shift = 0;
+
+    if (bucket < 2 * STATS_SUB_BUCKETS)
+        return (unsigned long long)bucket;
+
+    shift = bucket / STATS_SUB_BUCKETS - 1;
+
+    return ((unsigned long long)(bucket - shift * STATS_SUB_BUCKETS) << shift) + (1ull << shift) / 2;
+}
+
+// Get the latency below which a share (percent) of an operation's calls fell (never above the maximum)
+static unsigned long long percentile(const struct OperationStats* stats, unsigned long long calls, int percent)
+{
+    unsigned long long rank = (calls * (unsigned long long)percent + 99) / 100, seen = 0;
+    unsigned long long maximum = readCounter(&stats->maxNs);
+    int bucket = 0;
+
+    for (bucket = 0; bucket < STATS_BUCKETS; bucket++)
+    {
+        seen += readCounter(&stats->buckets[bucket]);
+        if (seen >= rank && seen > 0)
+            return bucketValue(bucket) < maximum ? bucketValue(bucket) : maximum;
+    }
+
+    return maximum;
+}
+
+#endif
+
+
+//////////////////////////////////////
+// STATS FUNCTIONS
+//////////////////////////////////////
+
+// Current monotonic time in nanoseconds
+long long statsClock(void)
+{
+    struct timespec now;
+
+#ifdef _WIN32
+    timespec_get(&now, TIME_UTC);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &now);
+#endif
+
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+// Record one call of an operation: its latency and the records it scanned (safe from any thread)
+void statsRecord(int operation, long long elapsedNs, long long scanned)
+{
+#ifndef CLINIC_NO_STATS
+    struct OperationStats* stats = &operations[operation];
+    unsigned long long elapsed = elapsedNs > 0 ? (unsigned long long)elapsedNs : 0;
+
+    if (isThreadPaused)
+        return;
+
+    addCounter(&stats->calls, 1);
+    addCounter(&stats->scanned, scanned > 0 ? (unsigned long long)scanned : 0);
+    addCounter(&stats->totalNs, elapsed);
+    addCounter(&stats->buckets[bucketOf(elapsed)], 1);
+    raiseMaximum(&stats->maxNs, elapsed);
+#else
+    (void)operation;
+    (void)elapsedNs;
+    (void)scanned;
+#endif
+}
+
+// Stop (1) or resume (0) recording on the calling thread, for work that repeats an operation already recorded
+void statsPause(int isPaused)
+{
+#ifndef CLINIC_NO_STATS
+    isThreadPaused = isPaused;
+#else
+    (void)isPaused;
+#endif
+}
+
+// Write a CSV row per operation called so far (returns # of rows, -1 if statistics are compiled out)
+int statsWrite(FILE* out)
+{
+#ifndef CLINIC_NO_STATS
+    const struct OperationStats* stats = NULL;
+    unsigned long long calls = 0;
+    int i = 0, rows = 0;
+
+    for (i = 0; i < STATS_OPERATIONS; i++)
+    {
+        stats = &operations[i];
+        calls = readCounter(&stats->calls);
+        if (calls > 0)
+        {
+            fprintf(out, "%s,%llu,%llu,%.1f,%llu,%llu,%llu,%llu\n", operationNames[i], calls,
+                    readCounter(&stats->scanned), (double)readCounter(&stats->totalNs) / (double)calls,
+                    percentile(stats, calls, 50), percentile(stats, calls, 90),
+                    percentile(stats, calls, 99), readCounter(&stats->maxNs));
+            rows++;
+        }
+    }
+
+    return rows;
+#else
+    (void)out;
+
+    return -1;
+#endif
+}
+
+// Write the CSV header and rows to a file (returns 1 on success, 0 on failure)
+int statsDump(const char* file)
+{
+#ifndef CLINIC_NO_STATS
+    FILE* out = fopen(file, "w");
+    int isWritten = 0;
+
+    if (out != NULL)
+    {
+        fprintf(out, "operation,calls,scanned,mean_ns,p50_ns,p90_ns,p99_ns,max_ns\n");
+        statsWrite(out);
+        isWritten = fclose(out) == 0;
+    }
+    if (!isWritten)
+        fprintf(stderr, "ERROR: Could not write statistics to %s\n", file);
+
+    return isWritten;
+#else
+    fprintf(stderr, "ERROR: Statistics are compiled out, so %s was not written\n", file);
+
+    return 0;
+#endif
+}
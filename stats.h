@@ -0,0 +1,82 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+
+// Environment variable naming the file the statistics are written to at exit
+#define STATS_FILE_VARIABLE "CLINIC_STATS_FILE"
+
+// Sub-buckets per power of two in a latency histogram (2^4: each bucket within 1/16 of its values)
+#define STATS_SUB_BUCKET_BITS 4
+#define STATS_SUB_BUCKETS (1 << STATS_SUB_BUCKET_BITS)
+
+// Buckets covering every latency up to 2^63 ns
+#define STATS_BUCKETS ((64 - STATS_SUB_BUCKET_BITS) * STATS_SUB_BUCKETS)
+
+// Operations measured
+#define STATS_IMPORT_PATIENTS 0
+#define STATS_IMPORT_APPOINTMENTS 1
+#define STATS_FIND_PATIENT 2
+#define STATS_FIND_PHONE 3
+#define STATS_VIEW_PATIENTS 4
+#define STATS_ADD_PATIENT 5
+#define STATS_EDIT_PATIENT 6
+#define STATS_REMOVE_PATIENT 7
+#define STATS_VIEW_SCHEDULE 8
+#define STATS_VIEW_APPOINTMENTS 9
+#define STATS_FIND_APPOINTMENT 10
+#define STATS_ADD_APPOINTMENT 11
+#define STATS_REMOVE_APPOINTMENT 12
+#define STATS_FREE_TIMESLOTS 13
+#define STATS_FREE_ROOMS 14
+#define STATS_FIND_NAME 15
+#define STATS_VIEW_RANGE 16
+#define STATS_PATIENT_APPOINTMENTS 17
+#define STATS_OPERATIONS 18
+
+// Time an operation: STATS_START declares its start time and STATS_STOP records the call with
+// the number of records it scanned. Building with CLINIC_NO_STATS compiles both out, so
+// nothing is timed or counted.
+#ifndef CLINIC_NO_STATS
+#define STATS_START(started) long long started = statsClock()
+#define STATS_STOP(operation, started, scanned) \
+    statsRecord((operation), statsClock() - (started), (long long)(scanned))
+#else
+#define STATS_START(started)
+#define STATS_STOP(operation, started, scanned) ((void)0)
+#endif
+
+//////////////////////////////////////
+// Structures
+//////////////////////////////////////
+
+// Data type: Operation Stats (calls, records scanned and a log-linear latency histogram of one operation)
+struct OperationStats
+{
+    unsigned long long calls;
+    unsigned long long scanned;
+    unsigned long long totalNs;
+    unsigned long long maxNs;
+    unsigned long long buckets[STATS_BUCKETS];
+};
+
+//////////////////////////////////////
+// STATS FUNCTIONS
+//////////////////////////////////////
+
+// Current monotonic time in nanoseconds
+long long statsClock(void);
+
+// Record one call of an operation: its latency and the records it scanned (safe from any thread)
+void statsRecord(int operation, long long elapsedNs, long long scanned);
+
+// Stop (1) or resume (0) recording on the calling thread, for work that repeats an operation already recorded
+void statsPause(int isPaused);
+
+// Write a CSV row per operation called so far (returns # of rows, -1 if statistics are compiled out)
+int statsWrite(FILE* out);
+
+// Write the CSV header and rows to a file (returns 1 on success, 0 on failure)
+int statsDump(const char* file);
+
+#endif // !STATS_H
@@ -0,0 +1,673 @@
+/*
+Store module
+- Storage functions: growable patient and appointment arrays
+  owned by the ClinicData structure.
+- Index maintenance functions: keep the lookup indexes in sync
+  with the patient array.
+- Appointment slab functions: appointments stay in the slot they
+  were given, so slots and handles remain valid; removal only marks
+  the slot, and removed slots are reclaimed in bulk.
+- Ordered appointment functions: keep a list of slots in date/time
+  order so views read it straight through, and a chain of each
+  patient's slots so one patient's appointments are found without it.
+*/
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "store.h"
+
+
+//////////////////////////////////////
+// STORE HELPER FUNCTIONS
+//////////////////////////////////////
+
+// Add the appointment in 'slot' to its patient's chain (numbers below 1 are never a patient's,
+// so those are left out; returns 1 on success, 0 if out of memory)
+static int indexAppointment(struct ClinicData* data, int slot)
+{
+    int patientNumber = data->appointments[slot].patientNumber;
+
+    return patientNumber <= 0 || multiIndexInsert(&data->appointmentIndex, patientNumber, slot);
+}
+
+
+//////////////////////////////////////
+// STORAGE FUNCTIONS
+//////////////////////////////////////
+
+// Grow a heap array so it can hold at least 'needed' items (returns 1 on success, 0 on failure)
+int growArray(void** items, int* capacity, int needed, size_t itemSize)
+{
+    int newCapacity = *capacity;
+    void* newItems = NULL;
+
+    if (needed <= *capacity)
+        return 1;
+
+    if (newCapacity < STORE_MIN_CAPACITY)
+        newCapacity = STORE_MIN_CAPACITY;
+
+    // Double the capacity so appends are amortized O(1)
+    while (newCapacity < needed)
+        newCapacity *= 2;
+
+    newItems = realloc(*items, (size_t)newCapacity * itemSize);
+    if (newItems == NULL)
+        return 0;
+
+    // Keep the unused tail zeroed so empty slots read as empty records
+    memset((char*)newItems + (size_t)*capacity * itemSize, 0,
+           (size_t)(newCapacity - *capacity) * itemSize);
+
+    *items = newItems;
+    *capacity = newCapacity;
+
+    return 1;
+}
+
+// Copy a borrowed (snapshot-mapped) array onto the heap so it can grow (returns 1 on success, 0 on failure)
+int unshareArray(void** items, int count, size_t itemSize, int* borrowed)
+{
+    void* copy = NULL;
+
+    if (*borrowed && count == 0)
+    {
+        *items = NULL;
+        *borrowed = 0;
+    }
+    else if (*borrowed)
+    {
+        copy = malloc((size_t)count * itemSize);
+        if (copy == NULL)
+            return 0;
+        memcpy(copy, *items, (size_t)count * itemSize);
+
+        *items = copy;
+        *borrowed = 0;
+    }
+
+    return 1;
+}
+
+// Initialize an empty clinic data store
+void storeInit(struct ClinicData* data)
+{
+    memset(data, 0, sizeof(*data));
+    data->freeAppointmentSlot = -1;
+}
+
+// Release all memory held by the clinic data store
+void storeFree(struct ClinicData* data)
+{
+    if (!data->patientsBorrowed)
+        free(data->patients);
+    if (!data->appointmentsBorrowed)
+        free(data->appointments);
+    if (!data->generationsBorrowed)
+        free(data->appointmentGenerations);
+    if (!data->appointmentOrderBorrowed)
+        free(data->appointmentOrder);
+    if (!data->freeSlotsBorrowed)
+        free(data->freeSlots);
+    patientIndexFree(&data->patientIndex);
+    multiIndexFree(&data->phoneIndex);
+    multiIndexFree(&data->appointmentIndex);
+    nameIndexFree(&data->nameIndex);
+    dayBitmapFree(&data->timeslots);
+    closeSnapshot(&data->snapshot);
+    storeInit(data);
+}
+
+// Copy the records and indexes into a store that shares no memory with them and has no journal
+// (the copy's arrays hold only the records in use; returns 1 on success, 0 if out of memory)
+int storeCopy(struct ClinicData* copy, const struct ClinicData* data)
+{
+    storeInit(copy);
+    copy->patients = data->patients;
+    copy->patientCount = copy->patientCapacity = data->patientCount;
+    copy->appointments = data->appointments;
+    copy->appointmentGenerations = data->appointmentGenerations;
+    copy->appointmentSlotCount = copy->appointmentCapacity = data->appointmentSlotCount;
+    copy->appointmentOrder = data->appointmentOrder;
+    copy->appointmentOrderCount = copy->appointmentOrderCapacity = data->appointmentOrderCount;
+    copy->appointmentCount = data->appointmentCount;
+    copy->freeAppointmentSlot = data->freeAppointmentSlot;
+    copy->freeSlots = data->freeSlots;
+    copy->freeSlotCount = copy->freeSlotCapacity = data->freeSlotCount;
+    copy->lastPatientNumber = data->lastPatientNumber;
+    copy->lastLsn = data->lastLsn;
+
+    // Every array starts out borrowed from the original and is then copied onto the heap
+    copy->patientsBorrowed = copy->appointmentsBorrowed = copy->generationsBorrowed = 1;
+    copy->appointmentOrderBorrowed = copy->freeSlotsBorrowed = 1;
+
+    if (!unshareArray((void**)&copy->patients, copy->patientCount,
+                      sizeof(struct Patient), &copy->patientsBorrowed) ||
+        !unshareArray((void**)&copy->appointments, copy->appointmentSlotCount,
+                      sizeof(struct Appointment), &copy->appointmentsBorrowed) ||
+        !unshareArray((void**)&copy->appointmentGenerations, copy->appointmentSlotCount,
+                      sizeof(unsigned int), &copy->generationsBorrowed) ||
+        !unshareArray((void**)&copy->appointmentOrder, copy->appointmentOrderCount,
+                      sizeof(int), &copy->appointmentOrderBorrowed) ||
+        !unshareArray((void**)&copy->freeSlots, copy->freeSlotCount,
+                      sizeof(int), &copy->freeSlotsBorrowed) ||
+        !storeReservePatients(copy, copy->patientCount) ||
+        !patientIndexCopy(&copy->patientIndex, &data->patientIndex) ||
+        !multiIndexCopy(&copy->phoneIndex, &data->phoneIndex) ||
+        !multiIndexCopy(&copy->appointmentIndex, &data->appointmentIndex) ||
+        !nameIndexCopy(&copy->nameIndex, &data->nameIndex) ||
+        !dayBitmapCopy(&copy->timeslots, &data->timeslots))
+    {
+        storeFree(copy);
+        return 0;
+    }
+
+    return 1;
+}
+
+// Reserve room for at least 'needed' patient records, and as many free list entries
+// (returns 1 on success, 0 on failure)
+int storeReservePatients(struct ClinicData* data, int needed)
+{
+    if (needed > data->patientCapacity &&
+        (!unshareArray((void**)&data->patients, data->patientCapacity,
+                       sizeof(struct Patient), &data->patientsBorrowed) ||
+         !growArray((void**)&data->patients, &data->patientCapacity, needed, sizeof(struct Patient))))
+        return 0;
+
+    // Every patient slot fits on the free list, so removing a patient never has to grow it
+    return data->freeSlotCapacity >= data->patientCapacity ||
+           (unshareArray((void**)&data->freeSlots, data->freeSlotCapacity, sizeof(int),
+                         &data->freeSlotsBorrowed) &&
+            growArray((void**)&data->freeSlots, &data->freeSlotCapacity,
+                      data->patientCapacity, sizeof(int)));
+}
+
+// Reserve room for at least 'needed' appointment slots and order entries (returns 1 on success, 0 on failure)
+int storeReserveAppointments(struct ClinicData* data, int needed)
+{
+    int generationCapacity = data->appointmentCapacity;
+
+    if (needed > data->appointmentCapacity &&
+        (!unshareArray((void**)&data->appointments, data->appointmentCapacity,
+                       sizeof(struct Appointment), &data->appointmentsBorrowed) ||
+         !unshareArray((void**)&data->appointmentGenerations, data->appointmentCapacity,
+                       sizeof(unsigned int), &data->generationsBorrowed)))
+        return 0;
+    if (needed > data->appointmentOrderCapacity &&
+        !unshareArray((void**)&data->appointmentOrder, data->appointmentOrderCapacity,
+                      sizeof(int), &data->appointmentOrderBorrowed))
+        return 0;
+
+    // Generations grow first: if the records then fail to grow, the spare room is harmless
+    return growArray((void**)&data->appointmentGenerations, &generationCapacity,
+                     needed, sizeof(unsigned int)) &&
+           growArray((void**)&data->appointments, &data->appointmentCapacity,
+                     needed, sizeof(struct Appointment)) &&
+           growArray((void**)&data->appointmentOrder, &data->appointmentOrderCapacity,
+                     needed, sizeof(int));
+}
+
+// Append an empty patient record to the store (returns NULL if out of memory)
+struct Patient* storeAppendPatient(struct ClinicData* data)
+{
+    struct Patient* patient = NULL;
+
+    if (storeReservePatients(data, data->patientCount + 1))
+    {
+        patient = &data->patients[data->patientCount++];
+        memset(patient, 0, sizeof(*patient));
+    }
+
+    return patient;
+}
+
+// Append a block of appointment records to new slots, unordered (returns 1 on success, 0 if out of memory)
+int storeAppendAppointments(struct ClinicData* data, const struct Appointment* appointments, int count)
+{
+    int i = 0, slot = data->appointmentSlotCount;
+
+    if (count <= 0)
+        return 1;
+
+    if (!storeReserveAppointments(data, (data->appointmentSlotCount > data->appointmentOrderCount ?
+                                         data->appointmentSlotCount : data->appointmentOrderCount) + count))
+        return 0;
+
+    memcpy(&data->appointments[slot], appointments, (size_t)count * sizeof(struct Appointment));
+    for (i = 0; i < count; i++)
+    {
+        data->appointmentGenerations[slot + i] = 1;
+        data->appointmentOrder[data->appointmentOrderCount++] = slot + i;
+    }
+    data->appointmentSlotCount += count;
+    data->appointmentCount += count;
+
+    return 1;
+}
+
+// Take the most recently vacated patient slot, or append one (returns its slot, -1 if out of memory)
+int storeAllocatePatient(struct ClinicData* data)
+{
+    int slot = -1;
+
+    // Vacated records were cleared when they were removed; the list is mapped from the snapshot
+    // unchecked, so a slot past the store is dropped
+    while (data->freeSlotCount > 0)
+    {
+        slot = data->freeSlots[--data->freeSlotCount];
+        if (slot >= 0 && slot < data->patientCount)
+            return slot;
+    }
+
+    return storeAppendPatient(data) != NULL ? data->patientCount - 1 : -1;
+}
+
+// Claim a specific vacated or next patient slot, as a replayed add does (returns 1 on success, 0 if not free)
+int storeClaimPatientSlot(struct ClinicData* data, int slot)
+{
+    int i = data->freeSlotCount - 1;
+
+    if (slot == data->patientCount)
+        return storeAppendPatient(data) != NULL;
+
+    // The original add took the top of the free list, so the search normally stops at once
+    while (i >= 0 && data->freeSlots[i] != slot)
+        i--;
+    if (i < 0)
+        return 0;
+
+    memmove(&data->freeSlots[i], &data->freeSlots[i + 1],
+            (size_t)(data->freeSlotCount - 1 - i) * sizeof(int));
+    data->freeSlotCount--;
+
+    return 1;
+}
+
+// Restore date/time order, booked timeslots and patient chains after appending appointments in bulk
+// (before any slot is removed or handed out; returns 1 on success, 0 if out of memory)
+int storeSortAppointments(struct ClinicData* data)
+{
+    unsigned long long visit = 0;
+    int i = 0, count = data->appointmentSlotCount;
+
+    if (count == 0)
+        return 1;
+
+    // Every slot is live and listed once, so the records can be sorted in place
+    sortAppointments(data->appointments, count);
+    for (i = 0; i < count; i++)
+        data->appointmentOrder[i] = i;
+
+    // Sorting moved the records, so the chains are rebuilt in slot (and so date) order
+    multiIndexFree(&data->appointmentIndex);
+    for (i = 0; i < count; i++)
+    {
+        if (!indexAppointment(data, i))
+            return 0;
+    }
+
+    // Sorted, the first and last records span every day to be marked
+    if (!dayBitmapReserve(&data->timeslots, timeslotKey((int)data->appointments[0].day, 1),
+                          timeslotKey((int)data->appointments[count - 1].day, CLINIC_ROOMS)))
+        return 0;
+
+    for (i = 0; i < count; i++)
+    {
+        visit = appointmentTimeslotMask(&data->appointments[i]);
+        if (visit != 0)
+            dayBitmapSet(&data->timeslots, timeslotKey((int)data->appointments[i].day,
+                                                       data->appointments[i].room), visit);
+    }
+
+    return 1;
+}
+
+
+//////////////////////////////////////
+// INDEX MAINTENANCE FUNCTIONS
+//////////////////////////////////////
+
+// Add the patient in 'slot' to the store indexes (returns 1 on success, 0 on failure)
+int storeIndexPatient(struct ClinicData* data, int slot)
+{
+    const struct Patient* patient = &data->patients[slot];
+
+    if (!patientIndexInsert(&data->patientIndex, patient->patientNumber, slot))
+        return 0;
+
+    if (patient->phoneKey != 0 && !multiIndexInsert(&data->phoneIndex, patient->phoneKey, slot))
+    {
+        patientIndexRemove(&data->patientIndex, patient->patientNumber);
+        return 0;
+    }
+
+    if (!nameIndexInsert(&data->nameIndex, slot, patient->name))
+    {
+        multiIndexRemove(&data->phoneIndex, patient->phoneKey, slot);
+        patientIndexRemove(&data->patientIndex, patient->patientNumber);
+        return 0;
+    }
+
+    if (patient->patientNumber > data->lastPatientNumber)
+        data->lastPatientNumber = patient->patientNumber;
+
+    return 1;
+}
+
+// Remove the patient in 'slot' from the store indexes, clear the record and free the slot
+void storeRemovePatient(struct ClinicData* data, int slot)
+{
+    patientIndexRemove(&data->patientIndex, data->patients[slot].patientNumber);
+    multiIndexRemove(&data->phoneIndex, data->patients[slot].phoneKey, slot);
+    nameIndexRemove(&data->nameIndex, slot, data->patients[slot].name);
+    memset(&data->patients[slot], 0, sizeof(struct Patient));
+
+    // The free list has room for every patient slot (see storeReservePatients); only a damaged
+    // snapshot's, listing slots still in use, could be full
+    if (data->freeSlotCount < data->freeSlotCapacity)
+        data->freeSlots[data->freeSlotCount++] = slot;
+}
+
+// Replace the phone of the patient in 'slot', re-indexing it (returns 1 on success, 0 on failure)
+int storeUpdatePatientPhone(struct ClinicData* data, int slot, int phoneType, long long phoneKey)
+{
+    struct Patient* patient = &data->patients[slot];
+    long long oldKey = patient->phoneKey, newKey = phoneKey;
+
+    if (newKey != oldKey)
+    {
+        // A slot sits on one phone chain at a time, so unlink it first
+        multiIndexRemove(&data->phoneIndex, oldKey, slot);
+        if (newKey != 0 && !multiIndexInsert(&data->phoneIndex, newKey, slot))
+        {
+            if (oldKey != 0)
+                multiIndexInsert(&data->phoneIndex, oldKey, slot);
+            return 0;
+        }
+    }
+    patient->phoneType = (unsigned char)phoneType;
+    patient->phoneKey = phoneKey;
+
+    return 1;
+}
+
+// Replace the name of the patient in 'slot', re-indexing it (returns 1 on success, 0 on failure)
+int storeUpdatePatientName(struct ClinicData* data, int slot, const char* name)
+{
+    struct Patient* patient = &data->patients[slot];
+    char oldName[NAME_LEN + 1] = { 0 };
+
+    if (strcmp(patient->name, name) == 0)
+        return 1;
+
+    // The name's nodes are found from the name it was indexed with, so unlink them first
+    memcpy(oldName, patient->name, sizeof(oldName));
+    nameIndexRemove(&data->nameIndex, slot, oldName);
+    if (!nameIndexInsert(&data->nameIndex, slot, name))
+    {
+        nameIndexInsert(&data->nameIndex, slot, oldName);
+        return 0;
+    }
+    strncpy(patient->name, name, NAME_LEN);
+    patient->name[NAME_LEN] = '\0';
+
+    return 1;
+}
+
+
+
+//////////////////////////////////////
+// APPOINTMENT SLAB FUNCTIONS
+//////////////////////////////////////
+
+// Check a slot read from the order list or free chain lies in the slab (they are mapped from the
+// snapshot unchecked, so each one is checked as it is followed)
+static int isAppointmentSlot(const struct ClinicData* data, int slot)
+{
+    return slot >= 0 && slot < data->appointmentSlotCount;
+}
+
+// Put a removed slot that is no longer in the order list on the free chain
+static void releaseAppointmentSlot(struct ClinicData* data, int slot)
+{
+    if (!isAppointmentSlot(data, slot))
+        return;
+
+    memset(&data->appointments[slot], 0, sizeof(struct Appointment));
+    data->appointments[slot].patientNumber = data->freeAppointmentSlot;
+    data->freeAppointmentSlot = slot;
+}
+
+// Take a slot from the free chain or the end of the slab (returns -1 if out of memory)
+static int allocateAppointmentSlot(struct ClinicData* data)
+{
+    int slot = data->freeAppointmentSlot;
+
+    // A damaged chain is cut where it leaves the slab
+    if (!isAppointmentSlot(data, slot))
+        slot = -1;
+    if (slot != -1)
+        data->freeAppointmentSlot = isAppointmentSlot(data, data->appointments[slot].patientNumber) ?
+                                    data->appointments[slot].patientNumber : -1;
+    else if (storeReserveAppointments(data, data->appointmentSlotCount + 1))
+        slot = data->appointmentSlotCount++;
+
+    return slot;
+}
+
+// Check if the appointment slot holds a live appointment
+int isAppointmentLive(const struct ClinicData* data, int slot)
+{
+    return isAppointmentSlot(data, slot) && (data->appointmentGenerations[slot] & 1u) != 0;
+}
+
+// Get a handle to the appointment in 'slot' (valid until that appointment is removed)
+struct AppointmentHandle storeAppointmentHandle(const struct ClinicData* data, int slot)
+{
+    struct AppointmentHandle handle;
+
+    handle.slot = slot;
+    handle.generation = data->appointmentGenerations[slot];
+
+    return handle;
+}
+
+// Get the slot an appointment handle refers to (returns -1 if it was removed)
+int storeResolveAppointment(const struct ClinicData* data, struct AppointmentHandle handle)
+{
+    return handle.slot >= 0 && handle.slot < data->appointmentSlotCount &&
+           (handle.generation & 1u) != 0 &&
+           data->appointmentGenerations[handle.slot] == handle.generation ? handle.slot : -1;
+}
+
+// Drop removed appointments from the order list and reclaim their slots in one pass
+void storeCompactAppointments(struct ClinicData* data)
+{
+    int from = 0, to = 0, slot = 0;
+
+    for (from = 0; from < data->appointmentOrderCount; from++)
+    {
+        slot = data->appointmentOrder[from];
+        if (isAppointmentLive(data, slot))
+            data->appointmentOrder[to++] = slot;
+        else
+            releaseAppointmentSlot(data, slot);
+    }
+    data->appointmentOrderCount = to;
+}
+
+
+//////////////////////////////////////
+// ORDERED APPOINTMENT FUNCTIONS
+//////////////////////////////////////
+
+// Get the appointment at an order position (a slot past the slab reads as a blank removed record)
+static const struct Appointment* orderedAppointment(const struct ClinicData* data, int position)
+{
+    static const struct Appointment blank = { 0 };
+    int slot = data->appointmentOrder[position];
+
+    return isAppointmentSlot(data, slot) ? &data->appointments[slot] : &blank;
+}
+
+// Clear a removed appointment's timeslots, except those another live visit in its room takes up
+static void releaseTimeslots(struct ClinicData* data, const struct Appointment* appoint)
+{
+    unsigned long long visit = appointmentTimeslotMask(appoint), kept = 0;
+    int day = (int)appoint->day, position = 0, slot = -1;
+
+    if (visit == 0)
+        return;
+
+    // Only imported double bookings can overlap, and those must stay marked
+    for (position = storeFirstAppointmentOnDay(data, day);
+         isAppointmentOnDay(data, position, day); position++)
+    {
+        slot = storeAppointmentAt(data, position);
+        if (slot != -1 && data->appointments[slot].room == appoint->room)
+            kept |= appointmentTimeslotMask(&data->appointments[slot]);
+    }
+    dayBitmapClear(&data->timeslots, timeslotKey(day, appoint->room), visit & ~kept);
+}
+
+// Insert an appointment at its date/time position (returns its slot, -1 if out of memory)
+int storeInsertAppointment(struct ClinicData* data, const struct Appointment* appoint)
+{
+    unsigned long long visit = appointmentTimeslotMask(appoint);
+    int slot = -1, position = 0, last = data->appointmentOrderCount;
+    int key = timeslotKey((int)appoint->day, appoint->room);
+
+    if (!storeReserveAppointments(data, data->appointmentOrderCount + 1) ||
+        (visit != 0 && !dayBitmapReserve(&data->timeslots, key, key)))
+        return -1;
+
+    slot = allocateAppointmentSlot(data);
+    if (slot == -1)
+        return -1;
+
+    data->appointments[slot] = *appoint;
+    if (!indexAppointment(data, slot))
+    {
+        releaseAppointmentSlot(data, slot);
+        return -1;
+    }
+    data->appointmentGenerations[slot]++;
+    data->appointmentCount++;
+    if (visit != 0)
+        dayBitmapSet(&data->timeslots, key, visit);
+
+    // A removed entry on either side of the position can be taken over without shifting
+    position = storeLowerBoundAppointment(data, appoint);
+    if (position > 0 && !isAppointmentLive(data, data->appointmentOrder[position - 1]))
+        releaseAppointmentSlot(data, data->appointmentOrder[--position]);
+    else if (position < last && !isAppointmentLive(data, data->appointmentOrder[position]))
+        releaseAppointmentSlot(data, data->appointmentOrder[position]);
+    else
+    {
+        memmove(&data->appointmentOrder[position + 1], &data->appointmentOrder[position],
+                (size_t)(last - position) * sizeof(int));
+        data->appointmentOrderCount++;
+    }
+    data->appointmentOrder[position] = slot;
+
+    return slot;
+}
+
+// Remove the appointment in 'slot' (its record keeps its place in the order until the next compaction)
+void storeRemoveAppointment(struct ClinicData* data, int slot)
+{
+    int removed = 0;
+
+    data->appointmentGenerations[slot]++;
+    data->appointmentCount--;
+    multiIndexRemove(&data->appointmentIndex, data->appointments[slot].patientNumber, slot);
+    releaseTimeslots(data, &data->appointments[slot]);
+
+    removed = data->appointmentOrderCount - data->appointmentCount;
+    if (removed >= STORE_MIN_CAPACITY &&
+        removed > data->appointmentOrderCount / 100 * STORE_COMPACT_PERCENT)
+        storeCompactAppointments(data);
+}
+
+// Remove every appointment of a patient, walking only that patient's chain (returns # removed)
+int storeRemovePatientAppointments(struct ClinicData* data, int patientNumber)
+{
+    int slot = multiIndexFirst(&data->appointmentIndex, patientNumber), removed = 0;
+
+    // Each removal unlinks the front of the chain
+    while (slot != -1)
+    {
+        storeRemoveAppointment(data, slot);
+        removed++;
+        slot = multiIndexFirst(&data->appointmentIndex, patientNumber);
+    }
+
+    return removed;
+}
+
+// Find a live appointment equal to 'appoint' (returns its slot, -1 if none)
+int storeFindAppointment(const struct ClinicData* data, const struct Appointment* appoint)
+{
+    int position = storeLowerBoundAppointment(data, appoint), slot = -1;
+
+    while (slot == -1 && position < data->appointmentOrderCount &&
+           compareAppointments(orderedAppointment(data, position), appoint) == 0)
+    {
+        if (isAppointmentLive(data, data->appointmentOrder[position]) &&
+            orderedAppointment(data, position)->room == appoint->room &&
+            orderedAppointment(data, position)->length == appoint->length)
+            slot = data->appointmentOrder[position];
+        position++;
+    }
+
+    return slot;
+}
+
+// Find the first order position that does not sort before 'appoint' (binary search)
+int storeLowerBoundAppointment(const struct ClinicData* data, const struct Appointment* appoint)
+{
+    int low = 0, high = data->appointmentOrderCount, middle = 0;
+
+    // Removed records keep their date and time, so the order list stays sorted
+    while (low < high)
+    {
+        middle = low + (high - low) / 2;
+        if (compareAppointments(orderedAppointment(data, middle), appoint) < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return low;
+}
+
+// Find the first order position on or after a day key (binary search)
+int storeFirstAppointmentOnDay(const struct ClinicData* data, int day)
+{
+    struct Appointment probe = { 0 };
+
+    // Sorts ahead of every appointment on the same day
+    probe.day = (unsigned int)day;
+    probe.minute = 0;
+    probe.patientNumber = INT_MIN;
+
+    return storeLowerBoundAppointment(data, &probe);
+}
+
+// Check if the order position holds an appointment (live or removed) on a day key
+int isAppointmentOnDay(const struct ClinicData* data, int position, int day)
+{
+    return position < data->appointmentOrderCount &&
+           (int)orderedAppointment(data, position)->day == day;
+}
+
+// Get the slot at an order position (returns -1 if that appointment was removed)
+int storeAppointmentAt(const struct ClinicData* data, int position)
+{
+    int slot = data->appointmentOrder[position];
+
+    return isAppointmentLive(data, slot) ? slot : -1;
+}
@@ -0,0 +1,119 @@
+#ifndef STORE_H
+#define STORE_H
+
+#include <stddef.h>
+
+#include "clinic.h"
+
+// Smallest capacity allocated the first time a store grows
+#define STORE_MIN_CAPACITY 16
+
+// Compact the appointment order once this percentage of its entries are removed
+#define STORE_COMPACT_PERCENT 25
+
+//////////////////////////////////////
+// STORAGE FUNCTIONS
+//////////////////////////////////////
+
+// Grow a heap array so it can hold at least 'needed' items (returns 1 on success, 0 on failure)
+int growArray(void** items, int* capacity, int needed, size_t itemSize);
+
+// Copy a borrowed (snapshot-mapped) array onto the heap so it can grow (returns 1 on success, 0 on failure)
+int unshareArray(void** items, int count, size_t itemSize, int* borrowed);
+
+// Initialize an empty clinic data store
+void storeInit(struct ClinicData* data);
+
+// Release all memory held by the clinic data store
+void storeFree(struct ClinicData* data);
+
+// Copy the records and indexes into a store that shares no memory with them and has no journal
+// (the copy's arrays hold only the records in use; returns 1 on success, 0 if out of memory)
+int storeCopy(struct ClinicData* copy, const struct ClinicData* data);
+
+// Reserve room for at least 'needed' patient records, and as many free list entries
+// (returns 1 on success, 0 on failure)
+int storeReservePatients(struct ClinicData* data, int needed);
+
+// Reserve room for at least 'needed' appointment slots and order entries (returns 1 on success, 0 on failure)
+int storeReserveAppointments(struct ClinicData* data, int needed);
+
+// Append an empty patient record to the store (returns NULL if out of memory)
+struct Patient* storeAppendPatient(struct ClinicData* data);
+
+// Append a block of appointment records to new slots, unordered (returns 1 on success, 0 if out of memory)
+int storeAppendAppointments(struct ClinicData* data, const struct Appointment* appointments, int count);
+
+// Take the most recently vacated patient slot, or append one (returns its slot, -1 if out of memory)
+int storeAllocatePatient(struct ClinicData* data);
+
+// Claim a specific vacated or next patient slot, as a replayed add does (returns 1 on success, 0 if not free)
+int storeClaimPatientSlot(struct ClinicData* data, int slot);
+
+// Restore date/time order, booked timeslots and patient chains after appending appointments in bulk
+// (before any slot is removed or handed out; returns 1 on success, 0 if out of memory)
+int storeSortAppointments(struct ClinicData* data);
+
+//////////////////////////////////////
+// INDEX MAINTENANCE FUNCTIONS
+//////////////////////////////////////
+
+// Add the patient in 'slot' to the store indexes (returns 1 on success, 0 on failure)
+int storeIndexPatient(struct ClinicData* data, int slot);
+
+// Remove the patient in 'slot' from the store indexes, clear the record and free the slot
+void storeRemovePatient(struct ClinicData* data, int slot);
+
+// Replace the phone of the patient in 'slot', re-indexing it (returns 1 on success, 0 on failure)
+int storeUpdatePatientPhone(struct ClinicData* data, int slot, int phoneType, long long phoneKey);
+
+// Replace the name of the patient in 'slot', re-indexing it (returns 1 on success, 0 on failure)
+int storeUpdatePatientName(struct ClinicData* data, int slot, const char* name);
+
+
+//////////////////////////////////////
+// APPOINTMENT SLAB FUNCTIONS
+//////////////////////////////////////
+
+// Check if the appointment slot holds a live appointment
+int isAppointmentLive(const struct ClinicData* data, int slot);
+
+// Get a handle to the appointment in 'slot' (valid until that appointment is removed)
+struct AppointmentHandle storeAppointmentHandle(const struct ClinicData* data, int slot);
+
+// Get the slot an appointment handle refers to (returns -1 if it was removed)
+int storeResolveAppointment(const struct ClinicData* data, struct AppointmentHandle handle);
+
+// Drop removed appointments from the order list and reclaim their slots in one pass
+void storeCompactAppointments(struct ClinicData* data);
+
+
+//////////////////////////////////////
+// ORDERED APPOINTMENT FUNCTIONS
+//////////////////////////////////////
+
+// Insert an appointment at its date/time position (returns its slot, -1 if out of memory)
+int storeInsertAppointment(struct ClinicData* data, const struct Appointment* appoint);
+
+// Remove the appointment in 'slot' (its record keeps its place in the order until the next compaction)
+void storeRemoveAppointment(struct ClinicData* data, int slot);
+
+// Remove every appointment of a patient, walking only that patient's chain (returns # removed)
+int storeRemovePatientAppointments(struct ClinicData* data, int patientNumber);
+
+// Find a live appointment equal to 'appoint' (returns its slot, -1 if none)
+int storeFindAppointment(const struct ClinicData* data, const struct Appointment* appoint);
+
+// Find the first order position that does not sort before 'appoint' (binary search)
+int storeLowerBoundAppointment(const struct ClinicData* data, const struct Appointment* appoint);
+
+// Find the first order position on or after a day key (binary search)
+int storeFirstAppointmentOnDay(const struct ClinicData* data, int day);
+
+// Check if the order position holds an appointment (live or removed) on a day key
+int isAppointmentOnDay(const struct ClinicData* data, int position, int day);
+
+// Get the slot at an order position (returns -1 if that appointment was removed)
+int storeAppointmentAt(const struct ClinicData* data, int position);
+
+#endif // !STORE_H
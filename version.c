@@ -0,0 +1,257 @@
+/*
+Version module
+- Version functions: read-copy-update publishing of the clinic data
+  for threads that share it. Readers take the published version with
+  no lock and read it for as long as they like. Writers change the
+  working data one at a time; a change is published by bringing a
+  spare version up to date and swapping it in with one pointer store,
+  so one publish covers every change made before it.
+- Epochs: a reader records the epoch it started in, and a replaced
+  version is reused (or freed) only once every reader has started in
+  a later epoch, so no reader ever sees a version change under it.
+- Change log: the batch command lines of the latest changes. A spare
+  version replays the ones it missed, which costs as much as the
+  changes themselves; only a spare too far behind (or none at all)
+  is replaced by a full copy of the working data.
+*/
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stats.h"
+#include "store.h"
+#include "version.h"
+
+// Only server mode shares the clinic data between threads
+#ifndef _WIN32
+
+//////////////////////////////////////
+// VERSION HELPER FUNCTIONS
+//////////////////////////////////////
+
+// Free a version and its data
+static void freeVersion(struct ClinicVersion* version)
+{
+    storeFree(&version->data);
+    free(version);
+}
+
+// Copy the working data into a new version (returns NULL if out of memory)
+static struct ClinicVersion* copyVersion(const struct ClinicData* data, unsigned long long changes)
+{
+    struct ClinicVersion* version = malloc(sizeof(*version));
+
+    if (version != NULL && !storeCopy(&version->data, data))
+    {
+        free(version);
+        version = NULL;
+    }
+    if (version != NULL)
+    {
+        version->changes = changes;
+        version->retiredEpoch = 0;
+        version->next = NULL;
+    }
+
+    return version;
+}
+
+// Move the replaced versions no reader can still be using to the spares, keeping only the newest spare
+// (publishLock held)
+static void reclaimVersions(struct VersionStore* store)
+{
+    struct ClinicVersion** link = &store->retired;
+    struct ClinicVersion* version = NULL;
+    unsigned long long oldest = ULLONG_MAX, epoch = 0;
+    int i = 0;
+
+    // 0 marks a reader that is not reading
+    for (i = 0; i < VERSION_MAX_READERS; i++)
+    {
+        epoch = __atomic_load_n(&store->readerEpochs[i], __ATOMIC_SEQ_CST);
+        if (epoch != 0 && epoch < oldest)
+            oldest = epoch;
+    }
+
+    while ((version = *link) != NULL)
+    {
+        if (version->retiredEpoch > oldest)
+            link = &version->next;
+        else
+        {
+            *link = version->next;
+
+            // The newest spare has the fewest changes to replay
+            if (store->spare == NULL || store->spare->changes < version->changes)
+            {
+                if (store->spare != NULL)
+                    freeVersion(store->spare);
+                version->next = NULL;
+                store->spare = version;
+            }
+            else
+                freeVersion(version);
+        }
+    }
+}
+
+// Bring the spare version up to 'changes' by replaying the change log (returns NULL if there is none
+// it can bring up to date; changeLock held)
+static struct ClinicVersion* updateSpare(struct VersionStore* store, unsigned long long changes)
+{
+    struct ClinicVersion* version = store->spare;
+    const struct VersionChange* change = NULL;
+
+    store->spare = NULL;
+    if (version != NULL && changes - version->changes > VERSION_LOG_SIZE)
+    {
+        freeVersion(version);
+        version = NULL;
+    }
+
+    // The statistics counted each change once already, when it was made
+    statsPause(1);
+    while (version != NULL && version->changes < changes)
+    {
+        change = &store->log[version->changes % VERSION_LOG_SIZE];
+
+        // Every version starts from the same records, so a change replays with the same result
+        // unless the spare ran out of memory; then it is dropped and copied afresh
+        if (runBatchLine(&version->data, change->line, change->line + change->lineLength,
+                         store->discard) != change->succeeded)
+        {
+            freeVersion(version);
+            version = NULL;
+        }
+        else
+            version->changes++;
+    }
+    statsPause(0);
+
+    return version;
+}
+
+
+//////////////////////////////////////
+// VERSION FUNCTIONS
+//////////////////////////////////////
+
+// Publish a first version of the clinic data (returns 1 on success, 0 if out of memory)
+int versionStoreInit(struct VersionStore* store, const struct ClinicData* data)
+{
+    memset(store, 0, sizeof(*store));
+    store->epoch = 1;
+    store->current = copyVersion(data, 0);
+    store->log = malloc(VERSION_LOG_SIZE * sizeof(struct VersionChange));
+    store->discard = fopen("/dev/null", "w");
+    pthread_mutex_init(&store->changeLock, NULL);
+    pthread_mutex_init(&store->publishLock, NULL);
+
+    return store->current != NULL && store->log != NULL && store->discard != NULL;
+}
+
+// Free every version (no reader may still be using one)
+void versionStoreFree(struct VersionStore* store)
+{
+    struct ClinicVersion* version = NULL;
+
+    if (store->current != NULL)
+        freeVersion(store->current);
+    if (store->spare != NULL)
+        freeVersion(store->spare);
+    while ((version = store->retired) != NULL)
+    {
+        store->retired = version->next;
+        freeVersion(version);
+    }
+
+    free(store->log);
+    if (store->discard != NULL)
+        fclose(store->discard);
+    pthread_mutex_destroy(&store->changeLock);
+    pthread_mutex_destroy(&store->publishLock);
+    memset(store, 0, sizeof(*store));
+}
+
+// Start reading: get the published version, which stays valid until versionLeave (read-only)
+struct ClinicData* versionEnter(struct VersionStore* store, int reader)
+{
+    // The epoch must be visible to publishers before the version is loaded (both sequentially consistent)
+    __atomic_store_n(&store->readerEpochs[reader],
+                     __atomic_load_n(&store->epoch, __ATOMIC_SEQ_CST), __ATOMIC_SEQ_CST);
+
+    return &__atomic_load_n(&store->current, __ATOMIC_SEQ_CST)->data;
+}
+
+// Stop reading the version returned by versionEnter
+void versionLeave(struct VersionStore* store, int reader)
+{
+    __atomic_store_n(&store->readerEpochs[reader], 0, __ATOMIC_RELEASE);
+}
+
+// Start changing the working clinic data (one writer at a time; readers carry on)
+void versionBeginChange(struct VersionStore* store)
+{
+    pthread_mutex_lock(&store->changeLock);
+}
+
+// Finish a change made by a batch command line, logging it for the spare versions (returns its number)
+unsigned long long versionEndChange(struct VersionStore* store, const char* line, const char* end,
+                                    int succeeded)
+{
+    struct VersionChange* change = &store->log[store->changes % VERSION_LOG_SIZE];
+    unsigned long long number = ++store->changes;
+    int length = (int)(end - line);
+
+    // Longer lines are rejected before they run
+    if (length > BATCH_LINE_LEN - 1)
+        length = BATCH_LINE_LEN - 1;
+    memcpy(change->line, line, (size_t)length);
+    change->lineLength = length;
+    change->succeeded = succeeded;
+    pthread_mutex_unlock(&store->changeLock);
+
+    return number;
+}
+
+// Make sure the published version includes change 'change' (returns 1 on success, 0 if out of memory)
+int versionPublish(struct VersionStore* store, const struct ClinicData* data, unsigned long long change)
+{
+    struct ClinicVersion* version = NULL;
+    struct ClinicVersion* replaced = NULL;
+    int isPublished = 1;
+
+    pthread_mutex_lock(&store->publishLock);
+    reclaimVersions(store);
+
+    // A version published for a later change already includes this one
+    if (store->current->changes < change)
+    {
+        pthread_mutex_lock(&store->changeLock);
+        version = updateSpare(store, store->changes);
+        if (version == NULL)
+            version = copyVersion(data, store->changes);
+        pthread_mutex_unlock(&store->changeLock);
+
+        if (version == NULL)
+            isPublished = 0;
+        else
+        {
+            // Readers that start after the epoch moves on cannot see the replaced version
+            replaced = store->current;
+            __atomic_store_n(&store->current, version, __ATOMIC_SEQ_CST);
+            replaced->retiredEpoch = __atomic_add_fetch(&store->epoch, 1, __ATOMIC_SEQ_CST);
+            replaced->next = store->retired;
+            store->retired = replaced;
+        }
+    }
+
+    pthread_mutex_unlock(&store->publishLock);
+
+    return isPublished;
+}
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef VERSION_H
+#define VERSION_H
+
+#include <stdio.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+#include "batch.h"
+#include "clinic.h"
+
+// Most reader threads a version store tracks (each needs its own reader number)
+#define VERSION_MAX_READERS 64
+
+// Changes kept for bringing a spare version up to date (older spares are copied afresh instead)
+#define VERSION_LOG_SIZE 4096
+
+//////////////////////////////////////
+// Structures
+//////////////////////////////////////
+
+// Data type: Clinic Version (one published, read-only copy of the clinic data)
+struct ClinicVersion
+{
+    struct ClinicData data;
+    unsigned long long changes;
+    unsigned long long retiredEpoch;
+    struct ClinicVersion* next;
+};
+
+// Data type: Version Change (a change's batch command line and whether it succeeded)
+struct VersionChange
+{
+    char line[BATCH_LINE_LEN];
+    int lineLength;
+    int succeeded;
+};
+
+// Data type: Version Store (the published version, the readers' epochs, the change log
+// and the replaced versions waiting for their readers or to be reused)
+struct VersionStore
+{
+    struct ClinicVersion* current;
+    unsigned long long epoch;
+    unsigned long long readerEpochs[VERSION_MAX_READERS];
+    unsigned long long changes;
+    struct VersionChange* log;
+    struct ClinicVersion* retired;
+    struct ClinicVersion* spare;
+    FILE* discard;
+#ifndef _WIN32
+    pthread_mutex_t changeLock;
+    pthread_mutex_t publishLock;
+#endif
+};
+
+//////////////////////////////////////
+// VERSION FUNCTIONS
+//////////////////////////////////////
+
+// Publish a first version of the clinic data (returns 1 on success, 0 if out of memory)
+int versionStoreInit(struct VersionStore* store, const struct ClinicData* data);
+
+// Free every version (no reader may still be using one)
+void versionStoreFree(struct VersionStore* store);
+
+// Start reading: get the published version, which stays valid until versionLeave (read-only)
+struct ClinicData* versionEnter(struct VersionStore* store, int reader);
+
+// Stop reading the version returned by versionEnter
+void versionLeave(struct VersionStore* store, int reader);
+
+// Start changing the working clinic data (one writer at a time; readers carry on)
+void versionBeginChange(struct VersionStore* store);
+
+// Finish a change made by a batch command line, logging it for the spare versions (returns its number)
+unsigned long long versionEndChange(struct VersionStore* store, const char* line, const char* end,
+                                    int succeeded);
+
+// Make sure the published version includes change 'change' (returns 1 on success, 0 if out of memory)
+int versionPublish(struct VersionStore* store, const struct ClinicData* data, unsigned long long change);
+
+#endif // !VERSION_H